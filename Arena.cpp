@@ -0,0 +1,72 @@
+#include "stdafx.h"
+#include "Arena.h"
+
+const size_t MinChunkSize = 64 * 1024;
+//a request that took more keeps no more than this for the next one
+const size_t MaxKeptSize = 1024 * 1024;
+const size_t Alignment = 8;
+
+Arena::Arena()
+	: next(NULL), end(NULL), usedBefore(0)
+{
+}
+
+Arena::~Arena()
+{
+	FreeChunks();
+}
+
+void *Arena::Allocate(size_t size)
+{
+	size = (size + Alignment - 1) & ~(Alignment - 1);
+	if (size > (size_t)(end - next))
+		AddChunk(size);
+
+	void *memory = next;
+	next += size;
+	return memory;
+}
+
+void Arena::Reset()
+{
+	if (chunks.size() > 1)
+	{
+		size_t used = usedBefore + (next - chunks.back().memory);
+		FreeChunks();
+		AddChunk(used < MaxKeptSize ? used : MaxKeptSize);
+	}
+
+	usedBefore = 0;
+	if (!chunks.empty())
+	{
+		next = chunks[0].memory;
+		end = next + chunks[0].size;
+	}
+}
+
+void Arena::AddChunk(size_t minSize)
+{
+	//the rest of the current chunk is given up
+	if (!chunks.empty())
+		usedBefore += next - chunks.back().memory;
+
+	Chunk chunk;
+	chunk.size = minSize > MinChunkSize ? minSize : MinChunkSize;
+	chunk.memory = (char *)VirtualAlloc(NULL, chunk.size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (chunk.memory == NULL)
+		throw std::bad_alloc();
+
+	chunks.push_back(chunk);
+	next = chunk.memory;
+	end = next + chunk.size;
+}
+
+void Arena::FreeChunks()
+{
+	for (size_t i = 0; i < chunks.size(); i++)
+		VirtualFree(chunks[i].memory, 0, MEM_RELEASE);
+	chunks.clear();
+	next = NULL;
+	end = NULL;
+	usedBefore = 0;
+}
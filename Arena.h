@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <new>
+
+// Monotonic memory for the scratch data of one completion request. Allocating
+// moves a pointer and freeing does nothing until Reset, which keeps the memory
+// for the next request. Chunks come from VirtualAlloc, away from the process
+// heap FAR and every other plugin share.
+class Arena
+{
+public:
+	Arena();
+	~Arena();
+
+	void *Allocate(size_t size);
+	//Forgets everything allocated; if it took more than one chunk, they are replaced
+	//with one big enough for all of it, up to a megabyte, so the next request takes none
+	void Reset();
+
+private:
+	struct Chunk
+	{
+		char *memory;
+		size_t size;
+	};
+
+	Arena(const Arena &);
+	Arena &operator=(const Arena &);
+
+	void AddChunk(size_t minSize);
+	void FreeChunks();
+
+	std::vector<Chunk> chunks;
+	char *next;
+	char *end;
+	size_t usedBefore;
+};
+
+// Standard allocator over an arena, for containers that live no longer than it.
+template <class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef T *pointer;
+	typedef const T *const_pointer;
+	typedef T &reference;
+	typedef const T &const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U> other;
+	};
+
+	explicit ArenaAllocator(Arena &arena) : arena(&arena)
+	{
+	}
+
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena(&other.GetArena())
+	{
+	}
+
+	Arena &GetArena() const
+	{
+		return *arena;
+	}
+
+	pointer address(reference value) const
+	{
+		return &value;
+	}
+
+	const_pointer address(const_reference value) const
+	{
+		return &value;
+	}
+
+	pointer allocate(size_type count, const void * = 0)
+	{
+		return (pointer)arena->Allocate(count * sizeof(T));
+	}
+
+	void deallocate(pointer, size_type)
+	{
+	}
+
+	size_type max_size() const
+	{
+		return (size_t)-1 / sizeof(T);
+	}
+
+	void construct(pointer place, const T &value)
+	{
+		new ((void *)place) T(value);
+	}
+
+	void destroy(pointer place)
+	{
+		place->~T();
+	}
+
+private:
+	Arena *arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+	return &a.GetArena() == &b.GetArena();
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+	return &a.GetArena() != &b.GetArena();
+}
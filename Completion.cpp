@@ -0,0 +1,897 @@
+#include "stdafx.h"
+#include "Completion.h"
+#include "WordTrie.h"
+#include "Proximity.h"
+#include "ParallelScan.h"
+#include "Tokenizer.h"
+#include "Dictionary.h"
+#include "Snapshot.h"
+#include "ProjectIndex.h"
+#include "Settings.h"
+#include "Timings.h"
+#include <vector>
+#include <set>
+#include <algorithm>
+
+using std::wstring;
+using std::vector;
+using std::set;
+
+enum WordsSearch
+{
+	PrefixSearch,
+	FuzzySearch,
+	TypoSearch
+};
+
+// Words of one search, found a menu page at a time. A search for more words
+// finds the same ones first, so the menu only grows as the user scrolls.
+class CompletionWords : public MenuItems
+{
+public:
+	CompletionWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state,
+		const wstring &wordToMatch, WordsSearch search);
+
+	//The first words, found in the phases of the request's timing
+	void FindFirst(int count);
+	int Count() const;
+	WordsSearch Search() const;
+
+	virtual int Fetch(int count);
+	virtual const wstring &Item(int index) const;
+
+private:
+	vector<wstring> Find(int maxCount, bool timed);
+
+	EditorHost &host;
+	const EditorInfo &editorInfo;
+	EditorState &state;
+	const wstring &wordToMatch;
+	WordsSearch search;
+	vector<wstring> words;
+	//the last search found fewer words than it was asked for
+	bool complete;
+};
+
+// Words that are all found already.
+class KnownWords : public MenuItems
+{
+public:
+	explicit KnownWords(const vector<wstring> &words);
+
+	virtual int Fetch(int count);
+	virtual const wstring &Item(int index) const;
+
+private:
+	const vector<wstring> &words;
+};
+
+bool FindAndWriteWord(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, bool fuzzy);
+bool ShowPopup(EditorHost &host, const EditorInfo &editorInfo, EditorState &state);
+vector<wstring> FindPopupWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const wstring &wordToMatch, int needed);
+bool NarrowPopupWords(PopupCache &cache, const wstring &wordToMatch, int needed, vector<wstring> &words);
+bool WriteGhostText(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, int color);
+bool IsGhostTextThere(EditorHost &host, const GhostText &ghost);
+bool IsGhostTextLastEdit(EditorHost &host, const GhostText &ghost);
+void ClearGhostColor(EditorHost &host, const GhostText &ghost);
+void MoveCursor(EditorHost &host, int line, int position);
+vector<wstring> FindFileWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const wstring &wordToMatch, bool fuzzy, int maxCount);
+vector<wstring> FindSimilarFileWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const wstring &wordToMatch, int maxCount);
+wstring GetCurrentWord(EditorHost &host, int position, const Delimiters &delimiters);
+vector<wstring> GatherWordsLikeThis(EditorHost &host, const wstring &wordToMatch, int currentLine, int linesCount,
+	const Delimiters &delimiters, int maxCount);
+vector<wstring> GatherFuzzyWords(EditorHost &host, const wstring &wordToMatch, int currentLine, int linesCount,
+	const Delimiters &delimiters, int maxCount);
+vector<wstring> GatherSimilarWords(EditorHost &host, const wstring &wordToMatch, int currentLine, int linesCount,
+	const Delimiters &delimiters, int maxCount);
+void AddNearbyLines(EditorHost &host, int currentLine, int linesCount, const Delimiters &delimiters, WordTrie &words);
+void AddProjectWords(const wstring &fileName, const wstring &wordToMatch, int maxCount, vector<wstring> &words);
+void AddDictionaryWords(const wstring &fileName, const wstring &wordToMatch, int maxCount, vector<wstring> &words);
+void AddNewWords(const vector<wstring> &found, int maxCount, vector<wstring> &words);
+void WriteWord(EditorHost &host, const wstring &word);
+void ReplaceWord(EditorHost &host, const EditorInfo &editorInfo, int typedLength, const wstring &word);
+
+static int LastGeneration = 0;
+//scratch memory of the request in progress
+static Arena RequestArena;
+//words around the cursor for the fuzzy and typo searches, kept to reuse its memory
+static WordTrie NearbyTrie;
+
+//smaller files are indexed faster than their snapshots are found
+const int MinSnapshotLines = 10000;
+
+bool CompleteWord(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, bool fuzzy)
+{
+	bool written;
+	if (!TimingsEnabled())
+		written = FindAndWriteWord(host, editorInfo, state, fuzzy);
+	else
+	{
+		TimedRequest request;
+		TimedEditorHost timedHost(host);
+		written = FindAndWriteWord(timedHost, editorInfo, state, fuzzy);
+	}
+	RequestArena.Reset();
+	return written;
+}
+
+bool FindAndWriteWord(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, bool fuzzy)
+{
+	if (editorInfo.CurPos == 0)
+		return false;
+
+	BeginPhase(PhaseFileWords);
+	wstring wordToMatch = GetCurrentWord(host, editorInfo.CurPos, state.delimiters);
+	CompletionWords words(host, editorInfo, state, wordToMatch, fuzzy ? FuzzySearch : PrefixSearch);
+	words.FindFirst(MaxMenuSize);
+
+	//nothing starts with what was typed, so it may have a typo in it
+	CompletionWords typos(host, editorInfo, state, wordToMatch, TypoSearch);
+	CompletionWords *found = &words;
+	if (words.Count() == 0 && !fuzzy)
+	{
+		typos.FindFirst(MaxMenuSize);
+		found = &typos;
+	}
+
+	if (found->Count() == 0)
+		return false;
+
+	int choice;
+	if (found->Count() > 1)
+	{
+		int x = editorInfo.CurPos - editorInfo.LeftPos;
+		int y = editorInfo.CurLine - editorInfo.TopScreenLine;
+		BeginPhase(PhaseMenu);
+		choice = host.Menu(*found, x, y);
+	}
+	else
+		choice = 0;
+
+	if (choice < 0)
+		return false;
+
+	BeginPhase(PhaseWrite);
+	wstring chosenWord = found->Item(choice);
+	if (found->Search() != PrefixSearch)
+		ReplaceWord(host, editorInfo, (int)wordToMatch.length(), chosenWord);
+	else
+		WriteWord(host, chosenWord.substr(wordToMatch.length(), chosenWord.length() - wordToMatch.length()));
+
+	return true;
+}
+
+CompletionWords::CompletionWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state,
+	const wstring &wordToMatch, WordsSearch search)
+	: host(host), editorInfo(editorInfo), state(state), wordToMatch(wordToMatch), search(search), complete(false)
+{
+}
+
+void CompletionWords::FindFirst(int count)
+{
+	words = Find(count, true);
+	complete = (int)words.size() < count;
+}
+
+int CompletionWords::Count() const
+{
+	return (int)words.size();
+}
+
+WordsSearch CompletionWords::Search() const
+{
+	return search;
+}
+
+int CompletionWords::Fetch(int count)
+{
+	if (count <= (int)words.size() || complete)
+		return (int)words.size();
+
+	//the words shown stay where they are even if the longer search ranks them differently
+	int maxCount = std::max(count, 2 * (int)words.size());
+	vector<wstring> found = Find(maxCount, false);
+	set<wstring> known(words.begin(), words.end());
+	size_t knownCount = words.size();
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		if (known.insert(found[i]).second)
+			words.push_back(found[i]);
+	}
+	complete = (int)found.size() < maxCount || words.size() == knownCount;
+	return (int)words.size();
+}
+
+const wstring &CompletionWords::Item(int index) const
+{
+	return words[index];
+}
+
+//the later pages are found while the menu is shown, which has a phase of its own
+vector<wstring> CompletionWords::Find(int maxCount, bool timed)
+{
+	if (search == FuzzySearch)
+		return FindFileWords(host, editorInfo, state, wordToMatch, true, maxCount);
+	if (search == TypoSearch)
+	{
+		if (timed)
+			BeginPhase(PhaseTypos);
+		return FindSimilarFileWords(host, editorInfo, state, wordToMatch, maxCount);
+	}
+
+	vector<wstring> found = FindFileWords(host, editorInfo, state, wordToMatch, false, maxCount);
+	if ((int)found.size() < maxCount)
+	{
+		wstring fileName = host.GetFileName();
+		if (timed)
+			BeginPhase(PhaseProjectWords);
+		AddProjectWords(fileName, wordToMatch, maxCount, found);
+		if (timed)
+			BeginPhase(PhaseDictionaries);
+		AddDictionaryWords(fileName, wordToMatch, maxCount, found);
+	}
+	return found;
+}
+
+KnownWords::KnownWords(const vector<wstring> &words)
+	: words(words)
+{
+}
+
+int KnownWords::Fetch(int count)
+{
+	return (int)words.size();
+}
+
+const wstring &KnownWords::Item(int index) const
+{
+	return words[index];
+}
+
+bool PopUpWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state)
+{
+	bool written;
+	if (!TimingsEnabled())
+		written = ShowPopup(host, editorInfo, state);
+	else
+	{
+		TimedRequest request;
+		TimedEditorHost timedHost(host);
+		written = ShowPopup(timedHost, editorInfo, state);
+	}
+	RequestArena.Reset();
+	return written;
+}
+
+bool ShowPopup(EditorHost &host, const EditorInfo &editorInfo, EditorState &state)
+{
+	//the user may be changing a word rather than typing a new one
+	EditorGetString line = host.GetLine(-1);
+	if (editorInfo.CurPos == 0 || editorInfo.CurPos > line.StringLength)
+		return false;
+	if (editorInfo.CurPos < line.StringLength && !IsDelimiter(line.StringText, editorInfo.CurPos, line.StringLength, state.delimiters))
+		return false;
+
+	int minLength = std::max(Options.autoPopupChars, 1);
+	BeginPhase(PhaseFileWords);
+	wstring wordToMatch = GetCurrentWord(host, editorInfo.CurPos, state.delimiters);
+	if ((int)wordToMatch.length() < minLength)
+		return false;
+
+	//FAR's menus are modal, so the keys typed into the popup are passed back
+	//here, go to the editor and the popup is shown again for the longer word
+	EditorInfo current = editorInfo;
+	bool written = false;
+	for (;;)
+	{
+		vector<wstring> words = FindPopupWords(host, current, state, wordToMatch, MaxMenuSize);
+		if (words.empty())
+			return written;
+
+		int x = current.CurPos - current.LeftPos;
+		int y = current.CurLine - current.TopScreenLine;
+		wchar_t typed = 0;
+		BeginPhase(PhaseMenu);
+		KnownWords items(words);
+		int choice = host.PopupMenu(items, x, y, typed);
+
+		BeginPhase(PhaseWrite);
+		if (choice >= 0)
+		{
+			const wstring &chosenWord = words[choice];
+			WriteWord(host, chosenWord.substr(wordToMatch.length(), chosenWord.length() - wordToMatch.length()));
+			return true;
+		}
+		if (typed == 0)
+			return written;
+
+		written = true;
+		if (typed == L'\b')
+		{
+			EditorSetPosition position;
+			position.CurLine = -1;
+			position.CurPos = current.CurPos - 1;
+			position.CurTabPos = -1;
+			position.TopScreenLine = -1;
+			position.LeftPos = -1;
+			position.Overtype = -1;
+			host.SetPosition(position);
+			host.DeleteChar();
+			wordToMatch.erase(wordToMatch.length() - 1);
+		}
+		else
+		{
+			wchar_t text[2] = { typed, 0 };
+			host.InsertText(text);
+			if (IsDelimiter(typed, state.delimiters))
+			{
+				host.Redraw();
+				return true;
+			}
+			wordToMatch += typed;
+		}
+		host.Redraw();
+		if ((int)wordToMatch.length() < minLength)
+			return true;
+
+		host.GetInfo(current);
+		BeginPhase(PhaseFileWords);
+	}
+}
+
+vector<wstring> FindPopupWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const wstring &wordToMatch, int needed)
+{
+	PopupCache &cache = state.popup;
+	int wordStart = editorInfo.CurPos - (int)wordToMatch.length();
+	vector<wstring> words;
+	if (cache.line == editorInfo.CurLine && cache.wordStart == wordStart
+		&& NarrowPopupWords(cache, wordToMatch, needed, words))
+	{
+		return words;
+	}
+
+	//a longer list than fits the menu, so the next letters can be matched against it
+	words = FindFileWords(host, editorInfo, state, wordToMatch, false, PopupCandidates);
+	if ((int)words.size() < PopupCandidates)
+	{
+		wstring fileName = host.GetFileName();
+		BeginPhase(PhaseProjectWords);
+		AddProjectWords(fileName, wordToMatch, PopupCandidates, words);
+		BeginPhase(PhaseDictionaries);
+		AddDictionaryWords(fileName, wordToMatch, PopupCandidates, words);
+	}
+
+	cache.line = editorInfo.CurLine;
+	cache.wordStart = wordStart;
+	cache.prefix = wordToMatch;
+	cache.words = words;
+	//the search around the cursor may have run out of time before it got them all
+	cache.complete = state.indexReady && (int)words.size() < PopupCandidates;
+	return words;
+}
+
+//false when the cached words can't tell which needed words come first for the longer beginning
+bool NarrowPopupWords(PopupCache &cache, const wstring &wordToMatch, int needed, vector<wstring> &words)
+{
+	if (wordToMatch.length() < cache.prefix.length() || wordToMatch.compare(0, cache.prefix.length(), cache.prefix) != 0)
+		return false;
+
+	//filtering keeps the order, and whatever comes first of the cached words
+	//also comes first among all the words, as long as enough of them are left
+	for (size_t i = 0; i < cache.words.size(); i++)
+	{
+		const wstring &word = cache.words[i];
+		if (word.length() > wordToMatch.length() && word.compare(0, wordToMatch.length(), wordToMatch) == 0)
+			words.push_back(word);
+	}
+	if (!cache.complete && (int)words.size() < needed)
+	{
+		words.clear();
+		return false;
+	}
+
+	cache.prefix = wordToMatch;
+	cache.words = words;
+	return true;
+}
+
+bool ShowGhostText(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, int color)
+{
+	bool shown;
+	if (!TimingsEnabled())
+		shown = WriteGhostText(host, editorInfo, state, color);
+	else
+	{
+		TimedRequest request;
+		TimedEditorHost timedHost(host);
+		shown = WriteGhostText(timedHost, editorInfo, state, color);
+	}
+	RequestArena.Reset();
+	return shown;
+}
+
+//the candidates are the popup's, so every next letter of the same word only
+//filters the cached list
+bool WriteGhostText(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, int color)
+{
+	if (!state.indexReady || !state.ghost.text.empty() || editorInfo.CurPos == 0)
+		return false;
+
+	//in overtype mode the ghost text would be written over the rest of the line
+	EditorGetString line = host.GetLine(-1);
+	if (editorInfo.CurPos > line.StringLength)
+		return false;
+	if (editorInfo.CurPos < line.StringLength && (editorInfo.Overtype || !IsDelimiter(line.StringText, editorInfo.CurPos, line.StringLength, state.delimiters)))
+		return false;
+
+	BeginPhase(PhaseFileWords);
+	wstring wordToMatch = GetCurrentWord(host, editorInfo.CurPos, state.delimiters);
+	if ((int)wordToMatch.length() < std::max(Options.autoPopupChars, 1))
+		return false;
+	vector<wstring> words = FindPopupWords(host, editorInfo, state, wordToMatch, 1);
+	if (words.empty())
+		return false;
+
+	BeginPhase(PhaseWrite);
+	GhostText &ghost = state.ghost;
+	ghost.line = editorInfo.CurLine;
+	ghost.start = editorInfo.CurPos;
+	ghost.text = words[0].substr(wordToMatch.length());
+	host.UndoRedo(EUR_BEGIN);
+	host.InsertText(ghost.text.c_str());
+	host.UndoRedo(EUR_END);
+	line = host.GetLine(ghost.line);
+	ghost.lineText.assign(line.StringText, line.StringLength);
+	ghost.linesCount = editorInfo.TotalLines;
+
+	EditorColor ghostColor;
+	ghostColor.StringNumber = ghost.line;
+	ghostColor.ColorItem = 0;
+	ghostColor.StartPos = ghost.start;
+	ghostColor.EndPos = ghost.start + (int)ghost.text.length() - 1;
+	ghostColor.Color = color;
+	host.AddColor(ghostColor);
+	MoveCursor(host, ghost.line, ghost.start);
+	host.Redraw();
+	return true;
+}
+
+void AcceptGhostText(EditorHost &host, EditorState &state)
+{
+	GhostText &ghost = state.ghost;
+	if (ghost.text.empty())
+		return;
+
+	if (IsGhostTextThere(host, ghost))
+	{
+		ClearGhostColor(host, ghost);
+		MoveCursor(host, ghost.line, ghost.start + (int)ghost.text.length());
+		host.Redraw();
+	}
+	ghost.text.clear();
+	ghost.lineText.clear();
+}
+
+void HideGhostText(EditorHost &host, EditorState &state)
+{
+	GhostText &ghost = state.ghost;
+	if (ghost.text.empty())
+		return;
+
+	//undone rather than deleted, so the undo history keeps no trace of it and
+	//a file that was saved before it is no longer modified. Undo would take
+	//back a macro's or another plugin's edit made since, so then just the
+	//ghost text is deleted. The key that hides it redraws the editor anyway
+	if (IsGhostTextThere(host, ghost))
+	{
+		ClearGhostColor(host, ghost);
+		if (IsGhostTextLastEdit(host, ghost))
+			host.UndoRedo(EUR_UNDO);
+		else
+		{
+			MoveCursor(host, ghost.line, ghost.start);
+			host.UndoRedo(EUR_BEGIN);
+			for (size_t i = 0; i < ghost.text.length(); i++)
+				host.DeleteChar();
+			host.UndoRedo(EUR_END);
+		}
+		MoveCursor(host, ghost.line, ghost.start);
+	}
+	ghost.text.clear();
+	ghost.lineText.clear();
+}
+
+bool IsGhostTextThere(EditorHost &host, const GhostText &ghost)
+{
+	EditorGetString line = host.GetLine(ghost.line);
+	return ghost.start + (int)ghost.text.length() <= line.StringLength
+		&& ghost.text.compare(0, ghost.text.length(), line.StringText + ghost.start, ghost.text.length()) == 0;
+}
+
+bool IsGhostTextLastEdit(EditorHost &host, const GhostText &ghost)
+{
+	EditorInfo editorInfo;
+	host.GetInfo(editorInfo);
+	if (editorInfo.TotalLines != ghost.linesCount)
+		return false;
+
+	EditorGetString line = host.GetLine(ghost.line);
+	return ghost.lineText.compare(0, ghost.lineText.length(), line.StringText, line.StringLength) == 0;
+}
+
+void ClearGhostColor(EditorHost &host, const GhostText &ghost)
+{
+	EditorColor noColor;
+	noColor.StringNumber = ghost.line;
+	noColor.ColorItem = 0;
+	noColor.StartPos = ghost.start;
+	noColor.EndPos = ghost.start + (int)ghost.text.length() - 1;
+	noColor.Color = 0;
+	host.AddColor(noColor);
+}
+
+void MoveCursor(EditorHost &host, int line, int position)
+{
+	EditorSetPosition setPosition;
+	setPosition.CurLine = line;
+	setPosition.CurPos = position;
+	setPosition.CurTabPos = -1;
+	setPosition.TopScreenLine = -1;
+	setPosition.LeftPos = -1;
+	setPosition.Overtype = -1;
+	host.SetPosition(setPosition);
+}
+
+//the words are returned rather than assigned, a copy of the menu would allocate every word again
+vector<wstring> FindFileWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const wstring &wordToMatch, bool fuzzy, int maxCount)
+{
+	if (state.indexReady)
+	{
+		UpdateIndex(host, editorInfo, state, true);
+		if (fuzzy)
+			return state.index.GetFuzzyWords(wordToMatch, maxCount);
+		return state.index.GetWordsLikeThis(wordToMatch, editorInfo.CurLine, maxCount, RequestArena);
+	}
+
+	if (fuzzy)
+		return GatherFuzzyWords(host, wordToMatch, editorInfo.CurLine, editorInfo.TotalLines, state.delimiters, maxCount);
+	return GatherWordsLikeThis(host, wordToMatch, editorInfo.CurLine, editorInfo.TotalLines, state.delimiters, maxCount);
+}
+
+vector<wstring> FindSimilarFileWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const wstring &wordToMatch, int maxCount)
+{
+	if (state.indexReady)
+		return state.index.GetSimilarWords(wordToMatch, maxCount);
+	return GatherSimilarWords(host, wordToMatch, editorInfo.CurLine, editorInfo.TotalLines, state.delimiters, maxCount);
+}
+
+void SetWordDividers(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const wstring &dividers)
+{
+	if (dividers == state.dividers)
+		return;
+
+	state.dividers = dividers;
+	CompileDelimiters(dividers.c_str(), state.delimiters);
+	state.popup = PopupCache();
+	if (!state.indexReady && state.pendingGeneration == 0)
+		return;
+
+	//the words of the index were divided the old way; until the new one is
+	//ready, the lines around the cursor are searched as if it wasn't there
+	state.index.Clear();
+	state.indexReady = false;
+	state.fromSnapshot = false;
+	StartIndexing(host, editorInfo, state);
+}
+
+void OpenIndex(EditorHost &host, const EditorInfo &editorInfo, EditorState &state)
+{
+	state.fileName = host.GetFileName();
+	//the project gets indexed while the user is busy with the file itself
+	if (Options.projectWords)
+		GetProjectIndex(state.fileName);
+
+	state.hasFileStamp = GetFileStamp(state.fileName, state.fileStamp);
+	if (!state.hasFileStamp || !HasSnapshot(state.fileName, state.fileStamp, state.delimiters.stamp))
+	{
+		StartIndexing(host, editorInfo, state);
+		return;
+	}
+
+	//the snapshot is read and checked on the indexer thread; meanwhile
+	//completion works from the lines around the cursor as usual
+	IndexJob *job = new IndexJob(editorInfo.EditorID, ++LastGeneration);
+	job->fileName = state.fileName;
+	job->fileStamp = state.fileStamp;
+	job->delimiters = state.delimiters;
+	state.pendingGeneration = job->generation;
+	QueueIndexJob(job);
+}
+
+void StartIndexing(EditorHost &host, const EditorInfo &editorInfo, EditorState &state)
+{
+	//editor API may only be used from the main thread, so take a snapshot here
+	//and leave the tokenizing to the indexer thread
+	IndexJob *job = new IndexJob(editorInfo.EditorID, ++LastGeneration);
+	job->lines.resize(editorInfo.TotalLines);
+	for (int lineNumber = 0; lineNumber < editorInfo.TotalLines; lineNumber++)
+	{
+		EditorGetString line = host.GetLine(lineNumber);
+		job->lines[lineNumber].assign(line.StringText, line.StringLength);
+	}
+	job->delimiters = state.delimiters;
+
+	state.pendingGeneration = job->generation;
+	QueueIndexJob(job);
+}
+
+void UpdateIndex(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, bool onlyCurrentLine)
+{
+	//a fresh index is on its way and will catch up when it arrives, but only
+	//around the cursor, so edits made meanwhile keep it out of snapshots
+	if (state.pendingGeneration != 0)
+	{
+		if (editorInfo.CurState & ECSTATE_MODIFIED)
+		{
+			state.modified = true;
+			state.savedGeneration = 0;
+		}
+		return;
+	}
+	if (!state.indexReady)
+	{
+		StartIndexing(host, editorInfo, state);
+		return;
+	}
+
+	WordIndex &index = state.index;
+	int delta = editorInfo.TotalLines - index.LinesCount();
+	int distance = delta > 0 ? delta : -delta;
+	if (distance > editorInfo.WindowSizeY)
+	{
+		state.modified = true;
+		state.fromSnapshot = false;
+		StartIndexing(host, editorInfo, state);
+		return;
+	}
+
+	//FAR doesn't tell where lines were inserted or deleted, so assume it happened
+	//at the cursor and re-read the neighbourhood to repair a wrong guess
+	if (delta > 0)
+		index.InsertLines(std::max(editorInfo.CurLine - delta + 1, 0), delta);
+	else if (delta < 0)
+		index.DeleteLines(editorInfo.CurLine + 1, -delta);
+
+	int firstLine = editorInfo.CurLine;
+	int lastLine = editorInfo.CurLine;
+	if (!onlyCurrentLine || delta != 0)
+	{
+		firstLine = std::min(editorInfo.TopScreenLine, editorInfo.CurLine - distance);
+		lastLine = std::max(editorInfo.TopScreenLine + editorInfo.WindowSizeY, editorInfo.CurLine + distance);
+	}
+	firstLine = std::max(firstLine, 0);
+	lastLine = std::min(lastLine, editorInfo.TotalLines - 1);
+
+	bool changed = delta != 0;
+	for (int lineNumber = firstLine; lineNumber <= lastLine; lineNumber++)
+	{
+		EditorGetString line = host.GetLine(lineNumber);
+		if (index.SetLine(lineNumber, line.StringText, line.StringLength, state.delimiters))
+			changed = true;
+	}
+	if (changed)
+	{
+		state.modified = true;
+		state.fromSnapshot = false;
+	}
+}
+
+bool InstallIndex(EditorState &state, IndexJob &job)
+{
+	if (state.pendingGeneration != job.generation)
+		return false;
+
+	//a failed job leaves the state without an index, so the next update starts a new one
+	state.pendingGeneration = 0;
+	if (!job.failed)
+	{
+		state.index.Swap(job.index);
+		state.indexReady = true;
+		state.fromSnapshot = !job.fileName.empty();
+		if (job.generation == state.savedGeneration)
+			state.modified = false;
+	}
+	state.savedGeneration = 0;
+	return true;
+}
+
+void IndexSavedFile(EditorHost &host, const EditorInfo &editorInfo, EditorState &state)
+{
+	state.fileName = host.GetFileName();
+	state.hasFileStamp = false;
+	state.stampAfterSave = true;
+	//the index was read in full and nothing changed since, or the file is too
+	//small to get a snapshot anyway
+	if (!state.modified || editorInfo.TotalLines < MinSnapshotLines)
+		return;
+
+	StartIndexing(host, editorInfo, state);
+	state.savedGeneration = state.pendingGeneration;
+}
+
+void StampSavedFile(const EditorInfo &editorInfo, EditorState &state)
+{
+	if (!state.stampAfterSave)
+		return;
+
+	//still modified when the file couldn't be written
+	state.stampAfterSave = false;
+	if (!(editorInfo.CurState & ECSTATE_MODIFIED))
+		state.hasFileStamp = GetFileStamp(state.fileName, state.fileStamp);
+}
+
+void SaveIndex(const EditorState &state)
+{
+	//an index of unsaved changes would be taken for the file's contents next time
+	if (!state.indexReady || state.pendingGeneration != 0 || state.modified || state.fromSnapshot)
+		return;
+	if (state.index.LinesCount() < MinSnapshotLines || !state.hasFileStamp)
+		return;
+
+	//changed on disk while it was open, the index is of the lines read before
+	FileStamp stamp;
+	if (!GetFileStamp(state.fileName, stamp) || !IsSameFileStamp(stamp, state.fileStamp))
+		return;
+
+	SaveSnapshot(state.fileName, state.fileStamp, state.delimiters.stamp, state.index);
+}
+
+wstring GetCurrentWord(EditorHost &host, int position, const Delimiters &delimiters)
+{
+	EditorGetString line = host.GetLine(-1);
+	//the cursor may stand beyond the end of the line
+	if (position > line.StringLength)
+		return wstring();
+
+	int wordStart = position;
+	while (wordStart > 0 && !IsDelimiter(line.StringText, wordStart - 1, line.StringLength, delimiters))
+		wordStart--;
+
+	return wstring(line.StringText + wordStart, position - wordStart);
+}
+
+vector<wstring> GatherWordsLikeThis(EditorHost &host, const wstring &wordToMatch, int currentLine, int linesCount,
+	const Delimiters &delimiters, int maxCount)
+{
+	//stop as soon as farther lines can't compete or the time is up. Only this
+	//thread may ask the editor for lines, so they are collected here and their
+	//words found on the scan threads, a distance bucket at a time because
+	//the scan can only stop between buckets anyway
+	typedef vector<ScanLine, ArenaAllocator<ScanLine> > ScanBatch;
+	WordRefLess less;
+	NearbyWords found(less, NearbyWords::allocator_type(RequestArena));
+	ArenaAllocator<ScanLine> lineAllocator(RequestArena);
+	ScanBatch batch(lineAllocator);
+	int batchLines = ScanBatchLines();
+	OutwardScan scan(currentLine, linesCount, Options.scanMilliseconds);
+	int lineNumber, distance;
+	for (;;)
+	{
+		bool more = scan.Next(lineNumber, distance);
+		if (!more || (int)batch.size() == batchLines
+			|| (!batch.empty() && DistanceBucket(distance) != DistanceBucket(batch.back().distance)))
+		{
+			if (!FindNearbyWordsInParallel(batch.empty() ? NULL : &batch[0], (int)batch.size(),
+				wordToMatch, delimiters, scan.Deadline(), found))
+			{
+				break;
+			}
+			batch.clear();
+		}
+		if (!more || CanStopScanning(distance, (int)found.size(), maxCount))
+			break;
+
+		EditorGetString line = host.GetLine(lineNumber);
+		ScanLine scanLine = { line.StringText, line.StringLength, distance };
+		batch.push_back(scanLine);
+	}
+	return RankNearbyWords(found, maxCount);
+}
+
+vector<wstring> GatherFuzzyWords(EditorHost &host, const wstring &wordToMatch, int currentLine, int linesCount,
+	const Delimiters &delimiters, int maxCount)
+{
+	vector<wstring> result;
+	FuzzyPattern pattern(wordToMatch);
+	if (!pattern.IsValid())
+		return result;
+
+	NearbyTrie.Clear();
+	AddNearbyLines(host, currentLine, linesCount, delimiters, NearbyTrie);
+	NearbyTrie.FindFuzzyWords(pattern, maxCount, result);
+	return result;
+}
+
+vector<wstring> GatherSimilarWords(EditorHost &host, const wstring &wordToMatch, int currentLine, int linesCount,
+	const Delimiters &delimiters, int maxCount)
+{
+	vector<wstring> result;
+	if (WordTrie::MaxTypos((int)wordToMatch.length()) == 0)
+		return result;
+
+	NearbyTrie.Clear();
+	AddNearbyLines(host, currentLine, linesCount, delimiters, NearbyTrie);
+	NearbyTrie.FindSimilarWords(wordToMatch, maxCount, result);
+	return result;
+}
+
+void AddNearbyLines(EditorHost &host, int currentLine, int linesCount, const Delimiters &delimiters, WordTrie &words)
+{
+	OutwardScan scan(currentLine, linesCount, Options.scanMilliseconds);
+	int lineNumber, distance;
+	while (scan.Next(lineNumber, distance))
+	{
+		EditorGetString line = host.GetLine(lineNumber);
+		WordScanner scanner(line.StringText, line.StringLength, delimiters);
+		int wordStart, wordEnd;
+		while (scanner.Next(wordStart, wordEnd))
+			words.Add(line.StringText + wordStart, wordEnd - wordStart);
+	}
+}
+
+void AddProjectWords(const wstring &fileName, const wstring &wordToMatch, int maxCount, vector<wstring> &words)
+{
+	if (!Options.projectWords || (int)words.size() >= maxCount)
+		return;
+
+	ProjectIndex *project = GetProjectIndex(fileName);
+	if (project == NULL)
+		return;
+
+	vector<wstring> found;
+	project->FindWordsLikeThis(wordToMatch, maxCount, found);
+	AddNewWords(found, maxCount, words);
+}
+
+void AddDictionaryWords(const wstring &fileName, const wstring &wordToMatch, int maxCount, vector<wstring> &words)
+{
+	//the file's own words come first, dictionaries fill up the rest of the menu
+	const vector<Dictionary *> &dictionaries = GetDictionaries(fileName);
+	for (size_t i = 0; i < dictionaries.size() && (int)words.size() < maxCount; i++)
+	{
+		vector<wstring> found;
+		dictionaries[i]->FindWordsLikeThis(wordToMatch, maxCount, found);
+		AddNewWords(found, maxCount, words);
+	}
+}
+
+void AddNewWords(const vector<wstring> &found, int maxCount, vector<wstring> &words)
+{
+	for (size_t i = 0; i < found.size() && (int)words.size() < maxCount; i++)
+	{
+		if (std::find(words.begin(), words.end(), found[i]) == words.end())
+			words.push_back(found[i]);
+	}
+}
+
+void WriteWord(EditorHost &host, const wstring &word)
+{
+	host.InsertText(word.c_str());
+	host.Redraw();
+}
+
+void ReplaceWord(EditorHost &host, const EditorInfo &editorInfo, int typedLength, const wstring &word)
+{
+	//a fuzzy match doesn't have to begin with what was typed, so retype the whole word
+	EditorSetPosition position;
+	position.CurLine = -1;
+	position.CurPos = editorInfo.CurPos - typedLength;
+	position.CurTabPos = -1;
+	position.TopScreenLine = -1;
+	position.LeftPos = -1;
+	position.Overtype = -1;
+	host.SetPosition(position);
+	for (int i = 0; i < typedLength; i++)
+		host.DeleteChar();
+	WriteWord(host, word);
+}
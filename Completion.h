@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "EditorHost.h"
+#include "WordIndex.h"
+#include "Indexer.h"
+#include "Tokenizer.h"
+#include "Snapshot.h"
+
+// Words last offered while typing. As long as the user keeps typing the same
+// word, its longer beginnings are matched against these instead of the file.
+struct PopupCache
+{
+	PopupCache() : line(-1), wordStart(-1), complete(false)
+	{
+	}
+
+	int line;
+	int wordStart;
+	std::wstring prefix;
+	std::vector<std::wstring> words;
+	//every word that starts with the prefix is here, not just the best ones
+	bool complete;
+};
+
+// The rest of the best word, written after the cursor in a dim color. It is
+// real text of the line, one step of undo that is undone when the next key,
+// saving the file or leaving the editor takes it away, unless Tab keeps it.
+struct GhostText
+{
+	GhostText() : line(-1), start(-1), linesCount(0)
+	{
+	}
+
+	int line;
+	int start;
+	//empty when none is shown
+	std::wstring text;
+	//the line and the editor's size right after the ghost text was written;
+	//FAR tells nothing of its undo history, so while these stay the same no
+	//other edit is taken to be made since
+	std::wstring lineText;
+	int linesCount;
+};
+
+struct EditorState
+{
+	EditorState()
+		: indexReady(false), pendingGeneration(0), savedGeneration(0), modified(false), fromSnapshot(false),
+		hasFileStamp(false), stampAfterSave(false), delimiters(DefaultDelimiters)
+	{
+	}
+
+	WordIndex index;
+	bool indexReady;
+	int pendingGeneration;
+	//the full read of the lines started when the file was saved
+	int savedGeneration;
+	std::wstring fileName;
+	//the index was patched line by line or the file edited since the index was
+	//read in full from the file on disk
+	bool modified;
+	//the index is the file's snapshot, saving it again would change nothing
+	bool fromSnapshot;
+	//of the file as the editor last read or wrote it; a file changed on disk
+	//since then doesn't match the lines indexed
+	FileStamp fileStamp;
+	bool hasFileStamp;
+	//the file is being saved, its stamp is taken once it is written
+	bool stampAfterSave;
+	PopupCache popup;
+	GhostText ghost;
+	//FAR's word dividers for the editor, compiled into delimiters; empty
+	//until they are set, the locale's rules are used meanwhile
+	std::wstring dividers;
+	Delimiters delimiters;
+};
+
+//rows of a menu, more words are looked for as it is scrolled
+const int MaxMenuSize = 20;
+//words kept for narrowing when the popup is shown for a new word
+const int PopupCandidates = 200;
+
+//Offers the words that complete the one before the cursor and writes the chosen one;
+//false when nothing was written and the key should go to the editor
+bool CompleteWord(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, bool fuzzy);
+//Offers the words while the user is typing one; every further letter typed into
+//the popup narrows it down. False when nothing was written
+bool PopUpWords(EditorHost &host, const EditorInfo &editorInfo, EditorState &state);
+//Writes the rest of the best word for the one before the cursor after it in
+//the color given, with the cursor left before it. Only indexed files get it,
+//a search of the lines around the cursor would be too slow for every keystroke
+bool ShowGhostText(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, int color);
+//Moves the cursor past the ghost text, which then stays as typed
+void AcceptGhostText(EditorHost &host, EditorState &state);
+//Takes the ghost text away, unless the line was changed under it meanwhile
+void HideGhostText(EditorHost &host, EditorState &state);
+
+//Words of the editor are divided at these characters from now on; when they
+//change, its index is made again
+void SetWordDividers(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, const std::wstring &dividers);
+void OpenIndex(EditorHost &host, const EditorInfo &editorInfo, EditorState &state);
+void StartIndexing(EditorHost &host, const EditorInfo &editorInfo, EditorState &state);
+void UpdateIndex(EditorHost &host, const EditorInfo &editorInfo, EditorState &state, bool onlyCurrentLine);
+//Takes the index of a finished job unless a newer one was started since
+bool InstallIndex(EditorState &state, IndexJob &job);
+//The file is being written; an index patched line by line may have missed
+//edits away from the cursor, so the saved lines are indexed again in full
+void IndexSavedFile(EditorHost &host, const EditorInfo &editorInfo, EditorState &state);
+//FAR tells of a save before writing the file, so its stamp is taken at the next redraw
+void StampSavedFile(const EditorInfo &editorInfo, EditorState &state);
+void SaveIndex(const EditorState &state);
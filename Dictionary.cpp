@@ -0,0 +1,266 @@
+#include "stdafx.h"
+#include "Dictionary.h"
+#include <stdio.h>
+#include <map>
+
+using std::wstring;
+using std::vector;
+using std::map;
+
+wstring GetExtension(const wstring &fileName);
+vector<Dictionary *> OpenDictionaries(const wstring &extension);
+
+static wstring DictionariesFolder;
+static map<wstring, vector<Dictionary *> > DictionariesByExtension;
+
+Dictionary::Dictionary()
+	: view(NULL), size(0), header(NULL), blockOffsets(NULL)
+{
+}
+
+Dictionary::~Dictionary()
+{
+	Close();
+}
+
+bool Dictionary::Open(const wstring &fileName)
+{
+	Close();
+
+	HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD fileSize = GetFileSize(file, NULL);
+	HANDLE mapping = NULL;
+	if (fileSize != INVALID_FILE_SIZE && fileSize >= sizeof(DictionaryHeader))
+		mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+	{
+		view = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (view == NULL)
+		return false;
+
+	//only the header is checked here, blocks are bounds-checked as they are read
+	size = fileSize;
+	header = (const DictionaryHeader *)view;
+	blockOffsets = (const unsigned int *)(view + sizeof(DictionaryHeader));
+	if (memcmp(header->magic, DictionaryMagic, sizeof(DictionaryMagic)) != 0
+		|| header->blocksCount > (size - sizeof(DictionaryHeader)) / sizeof(unsigned int))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void Dictionary::Close()
+{
+	if (view != NULL)
+		UnmapViewOfFile(view);
+	view = NULL;
+	size = 0;
+	header = NULL;
+	blockOffsets = NULL;
+}
+
+void Dictionary::FindWordsLikeThis(const wstring &prefix, int maxCount, vector<wstring> &result) const
+{
+	if (header == NULL || header->blocksCount == 0 || maxCount <= 0)
+		return;
+
+	//the last block that starts before the prefix is where its words begin
+	unsigned int low = 0;
+	unsigned int high = header->blocksCount;
+	while (high - low > 1)
+	{
+		unsigned int middle = low + (high - low) / 2;
+		if (CompareFirstWord(middle, prefix) < 0)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	int found = 0;
+	wstring word;
+	for (unsigned int block = low; block < header->blocksCount; block++)
+	{
+		const wchar_t *pos = BlockStart(block);
+		const wchar_t *end = BlockEnd(block);
+		bool first = true;
+		while (pos < end)
+		{
+			size_t shared = 0;
+			if (!first)
+			{
+				shared = *pos++;
+				if (pos == end || shared > word.length())
+					return;
+			}
+			size_t rest = *pos++;
+			if (rest > (size_t)(end - pos))
+				return;
+			word.resize(shared);
+			word.append(pos, rest);
+			pos += rest;
+			first = false;
+
+			int order = word.compare(0, prefix.length(), prefix);
+			if (order > 0)
+				return;
+			if (order == 0 && word.length() > prefix.length())
+			{
+				result.push_back(word);
+				if (++found == maxCount)
+					return;
+			}
+		}
+	}
+}
+
+//an offset past the end makes an empty block, and a file of an odd size ends
+//before its last byte, so no character is read across the end
+const wchar_t *Dictionary::BlockStart(unsigned int block) const
+{
+	unsigned int offset = blockOffsets[block];
+	if (offset > size - size % sizeof(wchar_t) || offset % sizeof(wchar_t) != 0)
+		return FileEnd();
+	return (const wchar_t *)(view + offset);
+}
+
+const wchar_t *Dictionary::BlockEnd(unsigned int block) const
+{
+	if (block + 1 >= header->blocksCount)
+		return FileEnd();
+	const wchar_t *end = BlockStart(block + 1);
+	return end < BlockStart(block) ? BlockStart(block) : end;
+}
+
+const wchar_t *Dictionary::FileEnd() const
+{
+	return (const wchar_t *)(view + size - size % sizeof(wchar_t));
+}
+
+int Dictionary::CompareFirstWord(unsigned int block, const wstring &prefix) const
+{
+	const wchar_t *pos = BlockStart(block);
+	const wchar_t *end = BlockEnd(block);
+	if (pos == end)
+		return -1;
+	size_t length = *pos++;
+	if (length > (size_t)(end - pos))
+		length = end - pos;
+
+	size_t common = length < prefix.length() ? length : prefix.length();
+	int order = wmemcmp(pos, prefix.c_str(), common);
+	if (order != 0)
+		return order;
+	return length < prefix.length() ? -1 : (length > prefix.length() ? 1 : 0);
+}
+
+bool WriteDictionary(const wstring &fileName, const vector<wstring> &words)
+{
+	DictionaryHeader header;
+	memcpy(header.magic, DictionaryMagic, sizeof(header.magic));
+	header.wordsCount = (unsigned int)words.size();
+	header.blocksCount = (unsigned int)((words.size() + DictionaryBlockSize - 1) / DictionaryBlockSize);
+
+	vector<unsigned int> blockOffsets(header.blocksCount);
+	size_t dataStart = sizeof(header) + blockOffsets.size() * sizeof(unsigned int);
+	vector<wchar_t> data;
+	for (size_t i = 0; i < words.size(); i++)
+	{
+		const wstring &word = words[i];
+		if (i % DictionaryBlockSize == 0)
+		{
+			blockOffsets[i / DictionaryBlockSize] = (unsigned int)(dataStart + data.size() * sizeof(wchar_t));
+			data.push_back((wchar_t)word.length());
+			data.insert(data.end(), word.begin(), word.end());
+			continue;
+		}
+
+		const wstring &previous = words[i - 1];
+		size_t shared = 0;
+		while (shared < word.length() && shared < previous.length() && word[shared] == previous[shared])
+			shared++;
+		data.push_back((wchar_t)shared);
+		data.push_back((wchar_t)(word.length() - shared));
+		data.insert(data.end(), word.begin() + shared, word.end());
+	}
+
+	FILE *file = _wfopen(fileName.c_str(), L"wb");
+	if (file == NULL)
+		return false;
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	if (written && !blockOffsets.empty())
+		written = fwrite(&blockOffsets[0], sizeof(unsigned int), blockOffsets.size(), file) == blockOffsets.size();
+	if (written && !data.empty())
+		written = fwrite(&data[0], sizeof(wchar_t), data.size(), file) == data.size();
+	return fclose(file) == 0 && written;
+}
+
+void SetDictionariesFolder(const wstring &folder)
+{
+	DictionariesFolder = folder;
+}
+
+const vector<Dictionary *> &GetDictionaries(const wstring &fileName)
+{
+	wstring extension = GetExtension(fileName);
+	map<wstring, vector<Dictionary *> >::iterator i = DictionariesByExtension.find(extension);
+	if (i == DictionariesByExtension.end())
+		i = DictionariesByExtension.insert(std::make_pair(extension, OpenDictionaries(extension))).first;
+	return i->second;
+}
+
+void CloseDictionaries()
+{
+	map<wstring, vector<Dictionary *> >::iterator i;
+	for (i = DictionariesByExtension.begin(); i != DictionariesByExtension.end(); ++i)
+	{
+		for (size_t j = 0; j < i->second.size(); j++)
+			delete i->second[j];
+	}
+	DictionariesByExtension.clear();
+}
+
+wstring GetExtension(const wstring &fileName)
+{
+	size_t dot = fileName.find_last_of(L".\\/");
+	if (dot == wstring::npos || fileName[dot] != L'.')
+		return wstring();
+
+	wstring extension = fileName.substr(dot + 1);
+	CharLowerBuffW(&extension[0], (DWORD)extension.length());
+	return extension;
+}
+
+vector<Dictionary *> OpenDictionaries(const wstring &extension)
+{
+	vector<Dictionary *> dictionaries;
+	if (extension.empty() || DictionariesFolder.empty())
+		return dictionaries;
+
+	wstring folder = DictionariesFolder + extension + L"\\";
+	WIN32_FIND_DATAW findData;
+	HANDLE find = FindFirstFileW((folder + L"*.wcd").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+		return dictionaries;
+
+	do
+	{
+		Dictionary *dictionary = new Dictionary();
+		if (dictionary->Open(folder + findData.cFileName))
+			dictionaries.push_back(dictionary);
+		else
+			delete dictionary;
+	}
+	while (FindNextFileW(find, &findData));
+	FindClose(find);
+	return dictionaries;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Read-only word list mapped straight from a .wcd file, so opening it costs a
+// few system calls and its pages are shared by every process that maps it.
+//
+// File layout, all numbers little-endian:
+//   DictionaryHeader
+//   unsigned int blockOffsets[blocksCount], in bytes from the start of the file
+//   blocks of up to DictionaryBlockSize sorted words, each a run of wchar_t:
+//     the first word as its length followed by its characters,
+//     every next one as the length it shares with the previous word,
+//     the length of the rest and the rest itself.
+struct DictionaryHeader
+{
+	char magic[4];
+	unsigned int wordsCount;
+	unsigned int blocksCount;
+};
+
+const char DictionaryMagic[4] = { 'W', 'C', 'D', '1' };
+const int DictionaryBlockSize = 32;
+
+class Dictionary
+{
+public:
+	Dictionary();
+	~Dictionary();
+
+	bool Open(const std::wstring &fileName);
+	void Close();
+
+	//Appends in alphabetical order up to maxCount words that start with the prefix and are longer than it
+	void FindWordsLikeThis(const std::wstring &prefix, int maxCount, std::vector<std::wstring> &result) const;
+
+private:
+	Dictionary(const Dictionary &);
+	Dictionary &operator=(const Dictionary &);
+
+	const wchar_t *BlockStart(unsigned int block) const;
+	const wchar_t *BlockEnd(unsigned int block) const;
+	const wchar_t *FileEnd() const;
+	int CompareFirstWord(unsigned int block, const std::wstring &prefix) const;
+
+	const unsigned char *view;
+	size_t size;
+	const DictionaryHeader *header;
+	const unsigned int *blockOffsets;
+};
+
+//Writes sorted, distinct words the way Dictionary reads them; MakeDictionary
+//builds dictionaries with it
+bool WriteDictionary(const std::wstring &fileName, const std::vector<std::wstring> &words);
+
+//Dictionaries live in <plugin folder>\Dictionaries\<file extension>\*.wcd and
+//get mapped the first time a file with that extension asks for them
+void SetDictionariesFolder(const std::wstring &folder);
+const std::vector<Dictionary *> &GetDictionaries(const std::wstring &fileName);
+void CloseDictionaries();
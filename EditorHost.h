@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "plugin.hpp"
+
+// Items of a menu, found as the menu gets to them rather than all at once.
+class MenuItems
+{
+public:
+	virtual ~MenuItems()
+	{
+	}
+
+	//Finds items until there are count of them or no more; returns how many there are
+	virtual int Fetch(int count) = 0;
+	virtual const std::wstring &Item(int index) const = 0;
+};
+
+// Everything the completion asks of the editor. The plugin passes FAR's editor
+// through it, the benchmark an in-memory buffer.
+class EditorHost
+{
+public:
+	virtual ~EditorHost()
+	{
+	}
+
+	virtual void GetInfo(EditorInfo &editorInfo) = 0;
+	//-1 is the line with the cursor
+	virtual EditorGetString GetLine(int lineNumber) = 0;
+	virtual std::wstring GetFileName() = 0;
+	virtual void SetPosition(const EditorSetPosition &position) = 0;
+	virtual void InsertText(const wchar_t *text) = 0;
+	virtual void DeleteChar() = 0;
+	//EUR_BEGIN and EUR_END make the changes between them one step of undo
+	virtual void UndoRedo(int command) = 0;
+	virtual void Redraw() = 0;
+	//Color 0 removes the colors that start at StartPos
+	virtual void AddColor(const EditorColor &color) = 0;
+	//Returns the chosen item or -1; x and y are relative to the editor window.
+	//The items known when it is called are shown first
+	virtual int Menu(MenuItems &items, int x, int y) = 0;
+	//Same as Menu, but typing closes it: then -1 is returned and typed is the
+	//character, L'\b' for Backspace, or 0 when the menu was just closed
+	virtual int PopupMenu(MenuItems &items, int x, int y, wchar_t &typed) = 0;
+};
@@ -0,0 +1,160 @@
+#include "stdafx.h"
+#include "Fuzzy.h"
+#include <wctype.h>
+
+using std::wstring;
+
+enum CharClass { OtherChar, LowerChar, UpperChar, DigitChar };
+
+static wchar_t Fold(wchar_t ch);
+static CharClass GetCharClass(wchar_t ch);
+static bool IsHumpStart(wchar_t previous, wchar_t ch, int position);
+
+FuzzyPattern::FuzzyPattern(const wstring &wordToMatch)
+	: fullMatch(0)
+{
+	for (int i = 0; i < 128; i++)
+		asciiBits[i] = 0;
+	for (int i = 0; i <= MaxLength; i++)
+		missingChars[i] = 0;
+
+	if (wordToMatch.empty() || wordToMatch.length() > MaxLength)
+		return;
+
+	for (size_t i = 0; i < wordToMatch.length(); i++)
+		query += Fold(wordToMatch[i]);
+	for (int i = 0; i < Length(); i++)
+	{
+		if ((unsigned int)query[i] < 128)
+			asciiBits[query[i]] |= 1u << i;
+	}
+	for (int i = Length() - 1; i >= 0; i--)
+		missingChars[i] = missingChars[i + 1] | FoldedCharsMask(query.c_str() + i, 1);
+	fullMatch = 1u << (Length() - 1);
+}
+
+bool FuzzyPattern::IsValid() const
+{
+	return fullMatch != 0;
+}
+
+int FuzzyPattern::Length() const
+{
+	return (int)query.length();
+}
+
+FuzzyPattern::State FuzzyPattern::Start() const
+{
+	State state;
+	state.humps = 0;
+	state.humpsEver = 0;
+	state.subsequence = 0;
+	state.matched = 0;
+	state.previous = 0;
+	state.length = 0;
+	return state;
+}
+
+void FuzzyPattern::Step(State &state, wchar_t ch) const
+{
+	unsigned int bits = QueryBits(Fold(ch));
+
+	//a chunk goes on with the next character or starts anew at a hump;
+	//once the first character missed, no chunk can start anymore
+	unsigned int chunkStarts = 0;
+	if ((state.length == 0 || state.humpsEver != 0) && IsHumpStart(state.previous, ch, state.length))
+		chunkStarts = (state.humpsEver << 1) | (state.length == 0 ? 1 : 0);
+	state.humps = ((state.humps << 1) | chunkStarts) & bits;
+	state.humpsEver |= state.humps;
+
+	state.subsequence |= ((state.subsequence << 1) | 1) & bits;
+	while (state.matched < Length() && (state.subsequence & (1u << state.matched)))
+		state.matched++;
+
+	state.previous = ch;
+	state.length++;
+}
+
+int FuzzyPattern::Tier(const State &state) const
+{
+	if (state.humpsEver & fullMatch)
+		return 0;
+	if (state.subsequence & fullMatch)
+		return 1;
+	return -1;
+}
+
+int FuzzyPattern::Match(const wchar_t *word, int length) const
+{
+	State state = Start();
+	for (int i = 0; i < length; i++)
+		Step(state, word[i]);
+	return Tier(state);
+}
+
+unsigned int FuzzyPattern::MissingChars(const State &state) const
+{
+	return missingChars[state.matched];
+}
+
+unsigned int FuzzyPattern::QueryBits(wchar_t folded) const
+{
+	if ((unsigned int)folded < 128)
+		return asciiBits[folded];
+
+	unsigned int bits = 0;
+	for (int i = 0; i < Length(); i++)
+	{
+		if (query[i] == folded)
+			bits |= 1u << i;
+	}
+	return bits;
+}
+
+unsigned int FoldedCharsMask(const wchar_t *text, int length)
+{
+	unsigned int mask = 0;
+	for (int i = 0; i < length; i++)
+		mask |= 1u << (Fold(text[i]) & 31);
+	return mask;
+}
+
+static wchar_t Fold(wchar_t ch)
+{
+	//the CRT goes through the locale for every call, so ASCII is done here
+	if (ch < 128)
+		return ch >= L'A' && ch <= L'Z' ? ch + (L'a' - L'A') : ch;
+	return (wchar_t)towlower(ch);
+}
+
+static CharClass GetCharClass(wchar_t ch)
+{
+	if (ch < 128)
+	{
+		if (ch >= L'a' && ch <= L'z')
+			return LowerChar;
+		if (ch >= L'A' && ch <= L'Z')
+			return UpperChar;
+		return ch >= L'0' && ch <= L'9' ? DigitChar : OtherChar;
+	}
+	if (iswupper(ch))
+		return UpperChar;
+	if (iswdigit(ch))
+		return DigitChar;
+	return iswalpha(ch) ? LowerChar : OtherChar;
+}
+
+static bool IsHumpStart(wchar_t previous, wchar_t ch, int position)
+{
+	if (position == 0)
+		return true;
+
+	CharClass previousClass = GetCharClass(previous);
+	CharClass charClass = GetCharClass(ch);
+	//underscores and other joiners stand on their own and start a hump after them
+	if (previousClass == OtherChar || charClass == OtherChar)
+		return true;
+	if (charClass == UpperChar)
+		return previousClass != UpperChar;
+	return (charClass == DigitChar) != (previousClass == DigitChar);
+}
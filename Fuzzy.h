@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+
+// Case-insensitive fuzzy query such as "gWLT" for GatherWordsLikeThis. Words are
+// fed to the matcher one character at a time, so a trie walk can share the work
+// between words with a common beginning. Bit i of a state says that query[0..i]
+// has been matched.
+class FuzzyPattern
+{
+public:
+	enum { MaxLength = 32 };
+
+	struct State
+	{
+		//query matched by chunks that begin at humps of the word, the first at its start
+		unsigned int humps;
+		unsigned int humpsEver;
+		//query matched as a plain subsequence
+		unsigned int subsequence;
+		int matched;
+		wchar_t previous;
+		int length;
+	};
+
+	FuzzyPattern(const std::wstring &query);
+
+	bool IsValid() const;
+	int Length() const;
+
+	State Start() const;
+	void Step(State &state, wchar_t ch) const;
+
+	//0 for abbreviations like gWLT, 1 for other subsequences, -1 if the word doesn't match
+	int Tier(const State &state) const;
+	int Match(const wchar_t *word, int length) const;
+
+	//Query characters the rest of the word has to contain, as a FoldedCharsMask
+	unsigned int MissingChars(const State &state) const;
+
+private:
+	unsigned int QueryBits(wchar_t folded) const;
+
+	std::wstring query;
+	unsigned int asciiBits[128];
+	unsigned int missingChars[MaxLength + 1];
+	unsigned int fullMatch;
+};
+
+//One bit per lowercased character modulo 32, to rule out words missing a character
+unsigned int FoldedCharsMask(const wchar_t *text, int length);
@@ -0,0 +1,144 @@
+#include "stdafx.h"
+#include "Indexer.h"
+#include "Snapshot.h"
+#include <deque>
+
+using std::wstring;
+using std::vector;
+using std::deque;
+
+DWORD WINAPI IndexerThread(LPVOID);
+void BuildJobIndex(IndexJob *job);
+
+static HANDLE WorkerThread = NULL;
+static HANDLE WakeUpEvent = NULL;
+static CRITICAL_SECTION QueueLock;
+static deque<IndexJob *> Queue;
+static IndexJob *CurrentJob = NULL;
+static bool StopRequested = false;
+static IndexJobDone OnJobDone = NULL;
+
+void StartIndexer(IndexJobDone onJobDone)
+{
+	if (WorkerThread != NULL)
+		return;
+
+	OnJobDone = onJobDone;
+	StopRequested = false;
+	InitializeCriticalSection(&QueueLock);
+	WakeUpEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	WorkerThread = CreateThread(NULL, 0, IndexerThread, NULL, 0, NULL);
+	SetThreadPriority(WorkerThread, THREAD_PRIORITY_BELOW_NORMAL);
+}
+
+void StopIndexer()
+{
+	if (WorkerThread == NULL)
+		return;
+
+	EnterCriticalSection(&QueueLock);
+	StopRequested = true;
+	if (CurrentJob != NULL)
+		CurrentJob->cancelled = 1;
+	LeaveCriticalSection(&QueueLock);
+
+	SetEvent(WakeUpEvent);
+	WaitForSingleObject(WorkerThread, INFINITE);
+	CloseHandle(WorkerThread);
+	CloseHandle(WakeUpEvent);
+	WorkerThread = NULL;
+	WakeUpEvent = NULL;
+
+	for (deque<IndexJob *>::iterator i = Queue.begin(); i != Queue.end(); ++i)
+		delete *i;
+	Queue.clear();
+	DeleteCriticalSection(&QueueLock);
+}
+
+void QueueIndexJob(IndexJob *job)
+{
+	EnterCriticalSection(&QueueLock);
+	Queue.push_back(job);
+	LeaveCriticalSection(&QueueLock);
+	SetEvent(WakeUpEvent);
+}
+
+void CancelIndexJobs(int editorId)
+{
+	if (WorkerThread == NULL)
+		return;
+
+	EnterCriticalSection(&QueueLock);
+	for (deque<IndexJob *>::iterator i = Queue.begin(); i != Queue.end(); )
+	{
+		if ((*i)->editorId == editorId)
+		{
+			delete *i;
+			i = Queue.erase(i);
+		}
+		else
+			++i;
+	}
+	if (CurrentJob != NULL && CurrentJob->editorId == editorId)
+		CurrentJob->cancelled = 1;
+	LeaveCriticalSection(&QueueLock);
+}
+
+DWORD WINAPI IndexerThread(LPVOID)
+{
+	for (;;)
+	{
+		WaitForSingleObject(WakeUpEvent, INFINITE);
+		for (;;)
+		{
+			EnterCriticalSection(&QueueLock);
+			if (StopRequested || Queue.empty())
+			{
+				bool stop = StopRequested;
+				LeaveCriticalSection(&QueueLock);
+				if (stop)
+					return 0;
+				break;
+			}
+			IndexJob *job = Queue.front();
+			Queue.pop_front();
+			CurrentJob = job;
+			LeaveCriticalSection(&QueueLock);
+
+			BuildJobIndex(job);
+
+			EnterCriticalSection(&QueueLock);
+			CurrentJob = NULL;
+			bool cancelled = job->cancelled != 0;
+			LeaveCriticalSection(&QueueLock);
+
+			if (cancelled)
+				delete job;
+			else
+				OnJobDone(job);
+		}
+	}
+}
+
+void BuildJobIndex(IndexJob *job)
+{
+	if (!job->fileName.empty())
+	{
+		job->failed = !LoadSnapshot(job->fileName, job->fileStamp, job->delimiters.stamp, job->index);
+		return;
+	}
+
+	int linesCount = (int)job->lines.size();
+	job->index.Clear();
+	job->index.InsertLines(0, linesCount);
+	for (int lineNumber = 0; lineNumber < linesCount; lineNumber++)
+	{
+		if ((lineNumber & 0xFF) == 0 && job->cancelled)
+			return;
+		const wstring &line = job->lines[lineNumber];
+		job->index.SetLine(lineNumber, line.c_str(), (int)line.length(), job->delimiters);
+	}
+
+	//the snapshot is no longer needed and may be large
+	vector<wstring>().swap(job->lines);
+}
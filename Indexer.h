@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "WordIndex.h"
+#include "Tokenizer.h"
+#include "Snapshot.h"
+
+// Snapshot of an editor's lines to be turned into a WordIndex off the UI thread,
+// or the name of a file whose index is to be loaded from the cache instead.
+struct IndexJob
+{
+	IndexJob(int editorId, int generation)
+		: editorId(editorId), generation(generation), failed(false), cancelled(0)
+	{
+	}
+
+	int editorId;
+	int generation;
+	std::vector<std::wstring> lines;
+	std::wstring fileName;
+	//of the file when the editor read it, the snapshot has to have the same
+	FileStamp fileStamp;
+	//the editor's, copied because the editor may be closed before the job is done
+	Delimiters delimiters;
+	bool failed;
+	WordIndex index;
+	volatile LONG cancelled;
+};
+
+// Called on the worker thread with a finished job; the receiver owns the job.
+// Anything that talks to the editor has to be passed to FAR's main thread first.
+typedef void (*IndexJobDone)(IndexJob *job);
+
+void StartIndexer(IndexJobDone onJobDone);
+void StopIndexer();
+void QueueIndexJob(IndexJob *job);
+void CancelIndexJobs(int editorId);
@@ -0,0 +1,188 @@
+#include "stdafx.h"
+#include "ParallelScan.h"
+#include <vector>
+#include <algorithm>
+
+using std::wstring;
+using std::vector;
+
+struct ScanThread
+{
+	HANDLE thread;
+	HANDLE wakeUpEvent;
+	Arena arena;
+};
+
+DWORD WINAPI ScanThreadProc(LPVOID param);
+void ScanChunks(Arena &arena);
+bool IsPast(LONGLONG deadline);
+
+//with the asking thread that makes eight, a scan of milliseconds gains little from more
+const int MaxScanThreads = 7;
+//fewer lines are found faster than the threads are woken up
+const int MinParallelLines = 4096;
+const int MaxBatchLines = 16384;
+//lines a thread takes at a time; the clock is read once a chunk
+const int ChunkLines = 64;
+
+static vector<ScanThread *> Threads;
+static bool StopRequested = false;
+static HANDLE DoneEvent = NULL;
+static CRITICAL_SECTION MergeLock;
+static Arena CallerArena;
+
+//the scan in progress, set before the threads are woken up
+static const ScanLine *ScanLines = NULL;
+static int ScanCount = 0;
+static const wstring *ScanPrefix = NULL;
+static const Delimiters *ScanDelimiters = NULL;
+static LONGLONG ScanDeadline = 0;
+static NearbyWords *ScanFound = NULL;
+static volatile LONG NextChunk = 0;
+static volatile LONG TimeIsUp = 0;
+static volatile LONG BusyThreads = 0;
+
+void StartScanThreads(int count)
+{
+	if (DoneEvent != NULL)
+		return;
+
+	StopRequested = false;
+	InitializeCriticalSection(&MergeLock);
+	DoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	for (int i = 0; i < count; i++)
+	{
+		ScanThread *scanThread = new ScanThread;
+		scanThread->wakeUpEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		scanThread->thread = CreateThread(NULL, 0, ScanThreadProc, scanThread, 0, NULL);
+		Threads.push_back(scanThread);
+	}
+}
+
+void StopScanThreads()
+{
+	if (DoneEvent == NULL)
+		return;
+
+	StopRequested = true;
+	for (size_t i = 0; i < Threads.size(); i++)
+	{
+		SetEvent(Threads[i]->wakeUpEvent);
+		WaitForSingleObject(Threads[i]->thread, INFINITE);
+		CloseHandle(Threads[i]->thread);
+		CloseHandle(Threads[i]->wakeUpEvent);
+		delete Threads[i];
+	}
+	Threads.clear();
+	CloseHandle(DoneEvent);
+	DoneEvent = NULL;
+	DeleteCriticalSection(&MergeLock);
+}
+
+int DefaultScanThreads()
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return std::min((int)systemInfo.dwNumberOfProcessors - 1, MaxScanThreads);
+}
+
+int ScanBatchLines()
+{
+	//alone, the asking thread reads the lines about as often as it used to read the clock
+	return Threads.empty() ? ChunkLines : MaxBatchLines;
+}
+
+bool FindNearbyWordsInParallel(const ScanLine *lines, int count, const wstring &prefix,
+	const Delimiters &delimiters, LONGLONG deadline, NearbyWords &found)
+{
+	if (count <= 0)
+		return !IsPast(deadline);
+
+	if (Threads.empty() || count < MinParallelLines)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (i % ChunkLines == 0 && IsPast(deadline))
+				return false;
+			FindNearbyWords(lines[i].text, lines[i].length, lines[i].distance, prefix, delimiters, found);
+		}
+		return true;
+	}
+
+	ScanLines = lines;
+	ScanCount = count;
+	ScanPrefix = &prefix;
+	ScanDelimiters = &delimiters;
+	ScanDeadline = deadline;
+	ScanFound = &found;
+	NextChunk = 0;
+	TimeIsUp = 0;
+
+	//no more threads than there are chunks for
+	int chunksCount = (count + ChunkLines - 1) / ChunkLines;
+	int helpers = std::min((int)Threads.size(), chunksCount - 1);
+	BusyThreads = helpers;
+	for (int i = 0; i < helpers; i++)
+		SetEvent(Threads[i]->wakeUpEvent);
+
+	ScanChunks(CallerArena);
+	if (helpers > 0)
+		WaitForSingleObject(DoneEvent, INFINITE);
+	return TimeIsUp == 0;
+}
+
+DWORD WINAPI ScanThreadProc(LPVOID param)
+{
+	ScanThread *scanThread = (ScanThread *)param;
+	for (;;)
+	{
+		WaitForSingleObject(scanThread->wakeUpEvent, INFINITE);
+		if (StopRequested)
+			return 0;
+
+		ScanChunks(scanThread->arena);
+		if (InterlockedDecrement(&BusyThreads) == 0)
+			SetEvent(DoneEvent);
+	}
+}
+
+//takes chunks in order, so the lines nearest to the cursor are read first
+//when the time runs out. The clock is read before a chunk is taken and every
+//chunk taken is read, so no nearer chunk is dropped for a farther one
+void ScanChunks(Arena &arena)
+{
+	{
+		WordRefLess less;
+		NearbyWords found(less, NearbyWords::allocator_type(arena));
+		for (;;)
+		{
+			if (TimeIsUp)
+				break;
+			if (IsPast(ScanDeadline))
+			{
+				TimeIsUp = 1;
+				break;
+			}
+			int first = (InterlockedIncrement(&NextChunk) - 1) * ChunkLines;
+			if (first >= ScanCount)
+				break;
+
+			int last = std::min(first + ChunkLines, ScanCount);
+			for (int i = first; i < last; i++)
+				FindNearbyWords(ScanLines[i].text, ScanLines[i].length, ScanLines[i].distance,
+					*ScanPrefix, *ScanDelimiters, found);
+		}
+
+		EnterCriticalSection(&MergeLock);
+		MergeNearbyWords(found, *ScanFound);
+		LeaveCriticalSection(&MergeLock);
+	}
+	arena.Reset();
+}
+
+bool IsPast(LONGLONG deadline)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart >= deadline;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include "Proximity.h"
+
+// Finds the words of many lines at once on a few threads kept for the purpose,
+// for the search around the cursor before the index is ready. Every thread
+// collects the words of the lines it takes in a map and an arena of its own;
+// the maps are merged into the request's one at the end.
+struct ScanLine
+{
+	const wchar_t *text;
+	int length;
+	int distance;
+};
+
+//Count helper threads; the thread that asks for a scan works too, so 0 means
+//every scan is done by the asking thread alone
+void StartScanThreads(int count);
+void StopScanThreads();
+//One less than the processors there are, or MaxScanThreads at most
+int DefaultScanThreads();
+//How many lines to collect before they are handed over at most; the lines
+//still being collected when the time runs out are dropped unread
+int ScanBatchLines();
+
+//The text of the lines must not change until it returns. False when the deadline
+//came before all lines were read
+bool FindNearbyWordsInParallel(const ScanLine *lines, int count, const std::wstring &prefix,
+	const Delimiters &delimiters, LONGLONG deadline, NearbyWords &found);
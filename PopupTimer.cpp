@@ -0,0 +1,103 @@
+#include "stdafx.h"
+#include "PopupTimer.h"
+
+DWORD WINAPI PopupTimerThread(LPVOID);
+
+static HANDLE TimerThread = NULL;
+static HANDLE WakeUpEvent = NULL;
+static CRITICAL_SECTION TimerLock;
+static bool Armed = false;
+static DWORD DueTime = 0;
+static bool StopRequested = false;
+static PopupDue OnDue = NULL;
+
+void StartPopupTimer(PopupDue onDue)
+{
+	if (TimerThread != NULL)
+		return;
+
+	OnDue = onDue;
+	Armed = false;
+	StopRequested = false;
+	InitializeCriticalSection(&TimerLock);
+	WakeUpEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	TimerThread = CreateThread(NULL, 0, PopupTimerThread, NULL, 0, NULL);
+}
+
+void StopPopupTimer()
+{
+	if (TimerThread == NULL)
+		return;
+
+	EnterCriticalSection(&TimerLock);
+	StopRequested = true;
+	LeaveCriticalSection(&TimerLock);
+
+	SetEvent(WakeUpEvent);
+	WaitForSingleObject(TimerThread, INFINITE);
+	CloseHandle(TimerThread);
+	CloseHandle(WakeUpEvent);
+	TimerThread = NULL;
+	WakeUpEvent = NULL;
+	DeleteCriticalSection(&TimerLock);
+}
+
+void RestartPopupTimer(int milliseconds)
+{
+	if (TimerThread == NULL)
+		return;
+
+	EnterCriticalSection(&TimerLock);
+	bool wasArmed = Armed;
+	Armed = true;
+	DueTime = GetTickCount() + milliseconds;
+	LeaveCriticalSection(&TimerLock);
+
+	//a later due time is noticed when the thread wakes up for the earlier one,
+	//so a keystroke only costs a system call when the thread sleeps for good
+	if (!wasArmed)
+		SetEvent(WakeUpEvent);
+}
+
+void CancelPopupTimer()
+{
+	if (TimerThread == NULL)
+		return;
+
+	EnterCriticalSection(&TimerLock);
+	Armed = false;
+	LeaveCriticalSection(&TimerLock);
+}
+
+DWORD WINAPI PopupTimerThread(LPVOID)
+{
+	for (;;)
+	{
+		EnterCriticalSection(&TimerLock);
+		if (StopRequested)
+		{
+			LeaveCriticalSection(&TimerLock);
+			return 0;
+		}
+		DWORD wait = INFINITE;
+		bool due = false;
+		if (Armed)
+		{
+			//the tick count wraps around every 49 days
+			LONG left = (LONG)(DueTime - GetTickCount());
+			if (left <= 0)
+			{
+				Armed = false;
+				due = true;
+			}
+			else
+				wait = (DWORD)left;
+		}
+		LeaveCriticalSection(&TimerLock);
+
+		if (due)
+			OnDue();
+		else
+			WaitForSingleObject(WakeUpEvent, wait);
+	}
+}
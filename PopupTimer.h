@@ -0,0 +1,12 @@
+#pragma once
+
+// Waits for the user to stop typing. Every keystroke restarts the timer, so the
+// callback only comes once the keyboard has been quiet for the whole delay.
+// The callback is made on the timer's thread; anything that talks to the editor
+// has to be passed to FAR's main thread first.
+typedef void (*PopupDue)();
+
+void StartPopupTimer(PopupDue onDue);
+void StopPopupTimer();
+void RestartPopupTimer(int milliseconds);
+void CancelPopupTimer();
@@ -0,0 +1,414 @@
+#include "stdafx.h"
+#include "ProjectIndex.h"
+#include "Tokenizer.h"
+#include <algorithm>
+
+using std::wstring;
+using std::vector;
+using std::map;
+
+bool IsProjectFolder(const wstring &folder);
+bool IsSkippedEntry(const WIN32_FIND_DATAW &findData);
+bool ReadText(const wstring &path, wstring &text);
+void FindDistinctWords(const wstring &text, vector<wstring> &found);
+
+const DWORD MaxFileSize = 1024 * 1024;
+const size_t MaxProjectFiles = 50000;
+//ids of the words of all files together, four bytes each
+const size_t MaxStoredWords = 4 * 1024 * 1024;
+const int MaxReadThreads = 4;
+const DWORD PollInterval = 60 * 1000;
+//a build or a checkout changes many files at once, wait for it to finish
+const DWORD SettleDelay = 1000;
+const size_t MaxProjects = 4;
+//a small pool isn't worth rebuilding however much of it is unused
+const unsigned int MinCompactedWords = 64 * 1024;
+
+static map<wstring, wstring> RootsByFolder;
+static map<wstring, ProjectIndex *> Projects;
+//the most recently used last
+static vector<wstring> RecentRoots;
+
+ProjectIndex::ProjectIndex(const wstring &root)
+	: root(root), thread(NULL), nextChanged(0), storedWords(0)
+{
+	InitializeCriticalSection(&lock);
+	stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	thread = CreateThread(NULL, 0, WatchThread, this, 0, NULL);
+	SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
+}
+
+ProjectIndex::~ProjectIndex()
+{
+	SetEvent(stopEvent);
+	if (thread != NULL)
+	{
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+	CloseHandle(stopEvent);
+	DeleteCriticalSection(&lock);
+}
+
+const wstring &ProjectIndex::Root() const
+{
+	return root;
+}
+
+void ProjectIndex::FindWordsLikeThis(const wstring &prefix, int maxCount, vector<wstring> &result)
+{
+	EnterCriticalSection(&lock);
+	words.FindWordsLikeThis(prefix, maxCount, result);
+	LeaveCriticalSection(&lock);
+}
+
+DWORD WINAPI ProjectIndex::WatchThread(LPVOID param)
+{
+	((ProjectIndex *)param)->Watch();
+	return 0;
+}
+
+DWORD WINAPI ProjectIndex::ReadThread(LPVOID param)
+{
+	((ProjectIndex *)param)->ReadNextFiles();
+	return 0;
+}
+
+void ProjectIndex::Watch()
+{
+	HANDLE change = FindFirstChangeNotificationW((root + L"\\").c_str(), TRUE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+		FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	HANDLE events[2] = { stopEvent, change };
+	DWORD eventsCount = change != INVALID_HANDLE_VALUE ? 2 : 1;
+	for (;;)
+	{
+		Rescan();
+		DWORD signalled = WaitForMultipleObjects(eventsCount, events, FALSE, PollInterval);
+		if (signalled == WAIT_OBJECT_0)
+			break;
+		if (signalled == WAIT_OBJECT_0 + 1)
+		{
+			if (WaitForSingleObject(stopEvent, SettleDelay) == WAIT_OBJECT_0)
+				break;
+			FindNextChangeNotification(change);
+		}
+	}
+
+	if (change != INVALID_HANDLE_VALUE)
+		FindCloseChangeNotification(change);
+}
+
+void ProjectIndex::Rescan()
+{
+	FileStamps found;
+	FindFiles(root, found);
+	//an interrupted scan would look like deleted files
+	if (IsStopping())
+		return;
+
+	changed.clear();
+	for (FileStamps::const_iterator i = found.begin(); i != found.end(); ++i)
+	{
+		FileStamps::const_iterator known = stamps.find(i->first);
+		if (known == stamps.end()
+			|| known->second.sizeLow != i->second.sizeLow || known->second.sizeHigh != i->second.sizeHigh
+			|| CompareFileTime(&known->second.lastWrite, &i->second.lastWrite) != 0)
+		{
+			changed.push_back(i->first);
+		}
+	}
+	for (FileStamps::const_iterator i = stamps.begin(); i != stamps.end(); ++i)
+	{
+		if (found.find(i->first) == found.end())
+			SetFileWords(i->first, vector<wstring>());
+	}
+
+	stamps.swap(found);
+	ReadChangedFiles();
+
+	//the readers are done and the completion only looks at the words, so the
+	//pool is the watch thread's alone now; words of changed and deleted files
+	//stay in it until it is rebuilt
+	if (pool.Count() > 2 * (unsigned int)words.WordsCount() + MinCompactedWords)
+		CompactPool();
+}
+
+void ProjectIndex::FindFiles(const wstring &folder, FileStamps &found) const
+{
+	WIN32_FIND_DATAW findData;
+	HANDLE find = FindFirstFileW((folder + L"\\*").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (found.size() >= MaxProjectFiles || IsStopping())
+			break;
+		if (IsSkippedEntry(findData))
+			continue;
+
+		wstring path = folder + L"\\" + findData.cFileName;
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			FindFiles(path, found);
+		else if (findData.nFileSizeHigh == 0 && findData.nFileSizeLow <= MaxFileSize)
+		{
+			FileStamp &stamp = found[path];
+			stamp.sizeLow = findData.nFileSizeLow;
+			stamp.sizeHigh = findData.nFileSizeHigh;
+			stamp.lastWrite = findData.ftLastWriteTime;
+		}
+	}
+	while (FindNextFileW(find, &findData));
+	FindClose(find);
+}
+
+void ProjectIndex::ReadChangedFiles()
+{
+	if (changed.empty())
+		return;
+
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	int threadsCount = std::min((int)systemInfo.dwNumberOfProcessors, MaxReadThreads);
+	threadsCount = std::min(threadsCount, (int)changed.size());
+
+	//the watch thread reads too, so one thread less is started
+	nextChanged = 0;
+	vector<HANDLE> readers;
+	for (int i = 1; i < threadsCount; i++)
+	{
+		HANDLE reader = CreateThread(NULL, 0, ReadThread, this, 0, NULL);
+		if (reader != NULL)
+		{
+			SetThreadPriority(reader, THREAD_PRIORITY_BELOW_NORMAL);
+			readers.push_back(reader);
+		}
+	}
+	ReadNextFiles();
+
+	if (!readers.empty())
+		WaitForMultipleObjects((DWORD)readers.size(), &readers[0], TRUE, INFINITE);
+	for (size_t i = 0; i < readers.size(); i++)
+		CloseHandle(readers[i]);
+	changed.clear();
+}
+
+void ProjectIndex::ReadNextFiles()
+{
+	for (;;)
+	{
+		LONG next = InterlockedIncrement(&nextChanged) - 1;
+		if (next >= (LONG)changed.size() || IsStopping())
+			return;
+
+		//tokenizing happens outside the lock, only the merge blocks completion
+		wstring text;
+		vector<wstring> fileWords;
+		const wstring &path = changed[next];
+		if (ReadText(path, text))
+			FindDistinctWords(text, fileWords);
+		SetFileWords(path, fileWords);
+	}
+}
+
+void ProjectIndex::SetFileWords(const wstring &path, const vector<wstring> &fileWords)
+{
+	EnterCriticalSection(&lock);
+	map<wstring, vector<unsigned int> >::iterator i = wordsByFile.find(path);
+	if (i != wordsByFile.end())
+	{
+		const vector<unsigned int> &ids = i->second;
+		for (size_t j = 0; j < ids.size(); j++)
+			words.Remove(pool.Text(ids[j]), pool.Length(ids[j]));
+		storedWords -= ids.size();
+		wordsByFile.erase(i);
+	}
+
+	//once the project is over the limit, new files stay out until they change
+	if (!fileWords.empty() && storedWords + fileWords.size() <= MaxStoredWords)
+	{
+		vector<unsigned int> &ids = wordsByFile[path];
+		ids.reserve(fileWords.size());
+		for (size_t j = 0; j < fileWords.size(); j++)
+		{
+			const wstring &word = fileWords[j];
+			ids.push_back(pool.Intern(word.c_str(), (int)word.length()));
+			words.Add(word.c_str(), (int)word.length());
+		}
+		storedWords += ids.size();
+	}
+	LeaveCriticalSection(&lock);
+}
+
+void ProjectIndex::CompactPool()
+{
+	WordPool compacted;
+	for (map<wstring, vector<unsigned int> >::iterator i = wordsByFile.begin(); i != wordsByFile.end(); ++i)
+	{
+		vector<unsigned int> &ids = i->second;
+		for (size_t j = 0; j < ids.size(); j++)
+			ids[j] = compacted.Intern(pool.Text(ids[j]), pool.Length(ids[j]));
+	}
+	pool.Swap(compacted);
+}
+
+bool ProjectIndex::IsStopping() const
+{
+	return WaitForSingleObject(stopEvent, 0) == WAIT_OBJECT_0;
+}
+
+wstring FindProjectRoot(const wstring &fileName)
+{
+	size_t slash = fileName.find_last_of(L"\\/");
+	if (slash == wstring::npos)
+		return wstring();
+
+	wstring folder = fileName.substr(0, slash);
+	map<wstring, wstring>::iterator known = RootsByFolder.find(folder);
+	if (known != RootsByFolder.end())
+		return known->second;
+
+	wstring root;
+	wstring candidate = folder;
+	while (!candidate.empty())
+	{
+		if (IsProjectFolder(candidate))
+		{
+			root = candidate;
+			break;
+		}
+		size_t parent = candidate.find_last_of(L"\\/");
+		if (parent == wstring::npos)
+			break;
+		candidate.erase(parent);
+	}
+
+	RootsByFolder[folder] = root;
+	return root;
+}
+
+ProjectIndex *GetProjectIndex(const wstring &fileName)
+{
+	wstring root = FindProjectRoot(fileName);
+	if (root.empty())
+		return NULL;
+
+	vector<wstring>::iterator recent = std::find(RecentRoots.begin(), RecentRoots.end(), root);
+	if (recent != RecentRoots.end())
+		RecentRoots.erase(recent);
+	RecentRoots.push_back(root);
+
+	map<wstring, ProjectIndex *>::iterator i = Projects.find(root);
+	if (i != Projects.end())
+		return i->second;
+
+	//every project keeps a thread and its words, so only the recently used ones stay
+	if (Projects.size() >= MaxProjects)
+	{
+		wstring oldest = RecentRoots.front();
+		RecentRoots.erase(RecentRoots.begin());
+		delete Projects[oldest];
+		Projects.erase(oldest);
+	}
+
+	ProjectIndex *project = new ProjectIndex(root);
+	Projects[root] = project;
+	return project;
+}
+
+void CloseProjectIndexes()
+{
+	for (map<wstring, ProjectIndex *>::iterator i = Projects.begin(); i != Projects.end(); ++i)
+		delete i->second;
+	Projects.clear();
+	RecentRoots.clear();
+	RootsByFolder.clear();
+}
+
+bool IsProjectFolder(const wstring &folder)
+{
+	const wchar_t *markers[] = { L".git", L".hg", L".svn", L".bzr" };
+	for (size_t i = 0; i < sizeof(markers) / sizeof(markers[0]); i++)
+	{
+		if (GetFileAttributesW((folder + L"\\" + markers[i]).c_str()) != INVALID_FILE_ATTRIBUTES)
+			return true;
+	}
+
+	WIN32_FIND_DATAW findData;
+	HANDLE find = FindFirstFileW((folder + L"\\*.sln").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+		return false;
+	FindClose(find);
+	return true;
+}
+
+bool IsSkippedEntry(const WIN32_FIND_DATAW &findData)
+{
+	//dot folders are version control and tool caches, links may loop back
+	if (findData.cFileName[0] == L'.')
+		return true;
+	if (findData.dwFileAttributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_REPARSE_POINT))
+		return true;
+	return (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && wcscmp(findData.cFileName, L"node_modules") == 0;
+}
+
+bool ReadText(const wstring &path, wstring &text)
+{
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD size = GetFileSize(file, NULL);
+	vector<char> bytes;
+	DWORD read = 0;
+	bool hasRead = size != INVALID_FILE_SIZE && size > 0 && size <= MaxFileSize;
+	if (hasRead)
+	{
+		bytes.resize(size);
+		hasRead = ReadFile(file, &bytes[0], size, &read, NULL) && read == size;
+	}
+	CloseHandle(file);
+	if (!hasRead)
+		return false;
+
+	if (size >= 2 && (unsigned char)bytes[0] == 0xFF && (unsigned char)bytes[1] == 0xFE)
+	{
+		text.assign((const wchar_t *)&bytes[2], (size - 2) / sizeof(wchar_t));
+		return true;
+	}
+	//anything else with zero bytes in it is a binary file
+	if (std::find(bytes.begin(), bytes.end(), 0) != bytes.end())
+		return false;
+
+	int start = 0;
+	if (size >= 3 && (unsigned char)bytes[0] == 0xEF && (unsigned char)bytes[1] == 0xBB && (unsigned char)bytes[2] == 0xBF)
+		start = 3;
+	if (start == (int)size)
+		return false;
+
+	UINT codePage = CP_UTF8;
+	int length = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, &bytes[start], (int)size - start, NULL, 0);
+	if (length == 0)
+	{
+		codePage = CP_ACP;
+		length = MultiByteToWideChar(CP_ACP, 0, &bytes[start], (int)size - start, NULL, 0);
+	}
+	if (length <= 0)
+		return false;
+
+	text.resize(length);
+	MultiByteToWideChar(codePage, 0, &bytes[start], (int)size - start, &text[0], length);
+	return true;
+}
+
+void FindDistinctWords(const wstring &text, vector<wstring> &found)
+{
+	WordScanner scanner(text.c_str(), (int)text.length(), DefaultDelimiters);
+	int wordStart, wordEnd;
+	while (scanner.Next(wordStart, wordEnd))
+		found.push_back(text.substr(wordStart, wordEnd - wordStart));
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include "WordTrie.h"
+#include "WordPool.h"
+
+// Words of every text file in the project of the edited file, counted once per
+// file that has them. Files are read on worker threads. The tree is rescanned
+// when Windows reports a change in it, and every PollInterval anyway because
+// network drives don't always report changes. A rescan compares sizes and
+// modification times and only reads the files that changed. Files keep the ids
+// of their words in a pool of the project.
+class ProjectIndex
+{
+public:
+	explicit ProjectIndex(const std::wstring &root);
+	~ProjectIndex();
+
+	const std::wstring &Root() const;
+
+	//Same as WordTrie::FindWordsLikeThis, the words used by more files first
+	void FindWordsLikeThis(const std::wstring &prefix, int maxCount, std::vector<std::wstring> &result);
+
+private:
+	struct FileStamp
+	{
+		DWORD sizeLow;
+		DWORD sizeHigh;
+		FILETIME lastWrite;
+	};
+
+	typedef std::map<std::wstring, FileStamp> FileStamps;
+
+	ProjectIndex(const ProjectIndex &);
+	ProjectIndex &operator=(const ProjectIndex &);
+
+	static DWORD WINAPI WatchThread(LPVOID param);
+	static DWORD WINAPI ReadThread(LPVOID param);
+	void Watch();
+	void Rescan();
+	void FindFiles(const std::wstring &folder, FileStamps &found) const;
+	void ReadChangedFiles();
+	void ReadNextFiles();
+	void SetFileWords(const std::wstring &path, const std::vector<std::wstring> &fileWords);
+	void CompactPool();
+	bool IsStopping() const;
+
+	std::wstring root;
+	HANDLE thread;
+	HANDLE stopEvent;
+
+	//owned by the watch thread
+	FileStamps stamps;
+	std::vector<std::wstring> changed;
+	volatile LONG nextChanged;
+
+	//changed by the readers under the lock, which the completion takes to look
+	//at the words; once the readers are done the watch thread compacts the pool
+	//without it
+	CRITICAL_SECTION lock;
+	WordPool pool;
+	std::map<std::wstring, std::vector<unsigned int> > wordsByFile;
+	WordTrie words;
+	size_t storedWords;
+};
+
+//The nearest folder above the file that has a .git, .hg, .svn or .bzr folder or
+//a .sln file in it, empty when the file is not in any project
+std::wstring FindProjectRoot(const std::wstring &fileName);
+
+//Starts indexing the project of the file the first time it is asked for;
+//NULL when the file is not in any project
+ProjectIndex *GetProjectIndex(const std::wstring &fileName);
+void CloseProjectIndexes();
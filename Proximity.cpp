@@ -0,0 +1,197 @@
+#include "stdafx.h"
+#include "Proximity.h"
+#include "Tokenizer.h"
+#include <algorithm>
+
+using std::wstring;
+using std::vector;
+
+bool IsRankedHigher(NearbyWords::const_iterator a, NearbyWords::const_iterator b);
+void AddNearbyWord(WordRef word, int distance, bool copyText, NearbyWords &found);
+WordRef CopyWord(WordRef word, Arena &arena);
+
+const int LinesBetweenClockChecks = 8;
+
+OutwardScan::OutwardScan(int currentLine, int linesCount, int milliseconds)
+	: currentLine(currentLine), linesCount(linesCount), distance(0), belowNext(false),
+	linesToCheck(LinesBetweenClockChecks)
+{
+	LARGE_INTEGER now, frequency;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&frequency);
+	deadline = now.QuadPart + frequency.QuadPart * milliseconds / 1000;
+}
+
+bool OutwardScan::Next(int &lineNumber, int &lineDistance)
+{
+	for (;;)
+	{
+		if (currentLine - distance < 0 && currentLine + distance >= linesCount)
+			return false;
+
+		//the line above goes first, then the one below, then one step farther
+		bool below = belowNext;
+		lineNumber = below ? currentLine + distance : currentLine - distance;
+		lineDistance = distance;
+		if (below || distance == 0)
+		{
+			distance++;
+			belowNext = false;
+		}
+		else
+			belowNext = true;
+
+		if (lineNumber < 0 || lineNumber >= linesCount)
+			continue;
+		return !IsTimeUp();
+	}
+}
+
+LONGLONG OutwardScan::Deadline() const
+{
+	return deadline;
+}
+
+bool OutwardScan::IsTimeUp()
+{
+	if (--linesToCheck > 0)
+		return false;
+
+	linesToCheck = LinesBetweenClockChecks;
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	if (now.QuadPart < deadline)
+		return false;
+
+	//stay stopped without reading the clock again
+	linesCount = 0;
+	currentLine = 0;
+	distance = 1;
+	return true;
+}
+
+bool WordRefLess::operator()(const WordRef &a, const WordRef &b) const
+{
+	int order = wmemcmp(a.text, b.text, std::min(a.length, b.length));
+	return order != 0 ? order < 0 : a.length < b.length;
+}
+
+void FindNearbyWords(const wchar_t *text, int length, int distance, const wstring &prefix,
+	const Delimiters &delimiters, NearbyWords &found)
+{
+	int prefixLength = (int)prefix.length();
+	WordScanner scanner(text, length, delimiters);
+	int wordStart, wordEnd;
+	while (scanner.Next(wordStart, wordEnd))
+	{
+		if (wordEnd - wordStart <= prefixLength
+			|| wmemcmp(text + wordStart, prefix.c_str(), prefixLength) != 0)
+		{
+			continue;
+		}
+
+		//the line may be gone by the time the words are ranked
+		WordRef word = { text + wordStart, wordEnd - wordStart };
+		AddNearbyWord(word, distance, true, found);
+	}
+}
+
+void FindNearbyWords(const WordPool &pool, const vector<unsigned int> &ids, int distance,
+	const wstring &prefix, NearbyWords &found)
+{
+	int prefixLength = (int)prefix.length();
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		WordRef word = { pool.Text(ids[i]), pool.Length(ids[i]) };
+		if (word.length > prefixLength && wmemcmp(word.text, prefix.c_str(), prefixLength) == 0)
+			AddNearbyWord(word, distance, false, found);
+	}
+}
+
+void MergeNearbyWords(const NearbyWords &words, NearbyWords &found)
+{
+	for (NearbyWords::const_iterator i = words.begin(); i != words.end(); ++i)
+	{
+		NearbyWords::iterator known = found.find(i->first);
+		if (known != found.end())
+		{
+			known->second.count += i->second.count;
+			known->second.distance = std::min(known->second.distance, i->second.distance);
+		}
+		else
+			found.insert(std::make_pair(CopyWord(i->first, found.get_allocator().GetArena()), i->second));
+	}
+}
+
+bool CanStopScanning(int distance, int foundCount, int maxCount)
+{
+	//farther lines can't outrank what is found already once a bucket is complete
+	return distance > 0
+		&& foundCount >= maxCount
+		&& DistanceBucket(distance) != DistanceBucket(distance - 1);
+}
+
+vector<wstring> RankNearbyWords(const NearbyWords &found, int maxCount)
+{
+	typedef ArenaAllocator<NearbyWords::const_iterator> RankedAllocator;
+	vector<NearbyWords::const_iterator, RankedAllocator> ranked(RankedAllocator(found.get_allocator().GetArena()));
+	ranked.reserve(found.size());
+	for (NearbyWords::const_iterator i = found.begin(); i != found.end(); ++i)
+		ranked.push_back(i);
+
+	size_t bestCount = std::min(ranked.size(), (size_t)std::max(maxCount, 0));
+	std::partial_sort(ranked.begin(), ranked.begin() + bestCount, ranked.end(), IsRankedHigher);
+
+	vector<wstring> result;
+	result.reserve(bestCount);
+	for (size_t i = 0; i < bestCount; i++)
+	{
+		result.push_back(wstring());
+		result.back().assign(ranked[i]->first.text, ranked[i]->first.length);
+	}
+	return result;
+}
+
+void AddNearbyWord(WordRef word, int distance, bool copyText, NearbyWords &found)
+{
+	NearbyWords::iterator i = found.find(word);
+	if (i != found.end())
+	{
+		i->second.count++;
+		return;
+	}
+
+	if (copyText)
+		word = CopyWord(word, found.get_allocator().GetArena());
+	NearbyWord nearby;
+	nearby.distance = distance;
+	nearby.count = 1;
+	found.insert(std::make_pair(word, nearby));
+}
+
+WordRef CopyWord(WordRef word, Arena &arena)
+{
+	wchar_t *copy = (wchar_t *)arena.Allocate(word.length * sizeof(wchar_t));
+	wmemcpy(copy, word.text, word.length);
+	word.text = copy;
+	return word;
+}
+
+int DistanceBucket(int distance)
+{
+	int bucket = 0;
+	for (; distance > 0; distance >>= 1)
+		bucket++;
+	return bucket;
+}
+
+bool IsRankedHigher(NearbyWords::const_iterator a, NearbyWords::const_iterator b)
+{
+	int bucketA = DistanceBucket(a->second.distance);
+	int bucketB = DistanceBucket(b->second.distance);
+	if (bucketA != bucketB)
+		return bucketA < bucketB;
+	if (a->second.count != b->second.count)
+		return a->second.count > b->second.count;
+	return WordRefLess()(a->first, b->first);
+}
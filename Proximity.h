@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include "Arena.h"
+#include "WordPool.h"
+
+struct Delimiters;
+
+// Characters of a word kept elsewhere, ordered the way std::wstring orders them.
+struct WordRef
+{
+	const wchar_t *text;
+	int length;
+};
+
+struct WordRefLess
+{
+	bool operator()(const WordRef &a, const WordRef &b) const;
+};
+
+// Completion candidates met around the cursor line. Lines are visited outwards
+// from the cursor, so the first occurrence of a word is its nearest one. The
+// words and the map itself live in the arena of the request.
+struct NearbyWord
+{
+	int distance;
+	int count;
+};
+
+typedef std::map<WordRef, NearbyWord, WordRefLess,
+	ArenaAllocator<std::pair<const WordRef, NearbyWord> > > NearbyWords;
+
+//An index knows every word of the file, it ranks only this far by distance
+const int ProximityRadius = 2000;
+
+// Line numbers outwards from the cursor line: the line itself, then the lines
+// one above and one below it, and so on until the file is covered or the time
+// is up. The clock is read every few lines, so a slow line can't go unnoticed
+// for long and a fast one isn't slowed down by the checks.
+class OutwardScan
+{
+public:
+	OutwardScan(int currentLine, int linesCount, int milliseconds);
+	bool Next(int &lineNumber, int &distance);
+	//In QueryPerformanceCounter ticks
+	LONGLONG Deadline() const;
+
+private:
+	bool IsTimeUp();
+
+	int currentLine;
+	int linesCount;
+	int distance;
+	bool belowNext;
+	int linesToCheck;
+	LONGLONG deadline;
+};
+
+void FindNearbyWords(const wchar_t *text, int length, int distance, const std::wstring &prefix,
+	const Delimiters &delimiters, NearbyWords &found);
+//Same for the words of a line kept as ids; the words found point into the pool,
+//so it must not change while they are in use
+void FindNearbyWords(const WordPool &pool, const std::vector<unsigned int> &ids, int distance,
+	const std::wstring &prefix, NearbyWords &found);
+//Adds the words found elsewhere, counts summed and the nearest distance kept;
+//their text is copied into the arena of found
+void MergeNearbyWords(const NearbyWords &words, NearbyWords &found);
+bool CanStopScanning(int distance, int foundCount, int maxCount);
+//Distances rounded up to the same power of two rank the same
+int DistanceBucket(int distance);
+
+//Ranks by the distance rounded up to a power of two, then by count, then alphabetically
+std::vector<std::wstring> RankNearbyWords(const NearbyWords &found, int maxCount);
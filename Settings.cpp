@@ -0,0 +1,135 @@
+#include "stdafx.h"
+#include "Settings.h"
+
+using std::wstring;
+
+bool ReadOption(HKEY key, const wchar_t *name, bool defaultValue);
+void WriteOption(HKEY key, const wchar_t *name, bool value);
+int ReadNumber(HKEY key, const wchar_t *name, int defaultValue);
+void WriteNumber(HKEY key, const wchar_t *name, int value);
+void ReadWordDividers(HKEY key, std::map<wstring, wstring> &wordDividers);
+
+Settings Options;
+
+static wstring SettingsKey;
+
+Settings::Settings()
+	: projectWords(false), measureTimings(false), scanMilliseconds(10),
+	autoPopup(false), autoPopupChars(3), autoPopupDelay(150), ghostText(false)
+{
+}
+
+void LoadSettings(const wstring &rootKey)
+{
+	SettingsKey = rootKey + L"\\WordsComplete";
+	Settings defaults;
+	HKEY key;
+	if (RegOpenKeyExW(HKEY_CURRENT_USER, SettingsKey.c_str(), 0, KEY_READ, &key) != ERROR_SUCCESS)
+	{
+		Options = defaults;
+		return;
+	}
+
+	Options.projectWords = ReadOption(key, L"ProjectWords", defaults.projectWords);
+	Options.measureTimings = ReadOption(key, L"MeasureTimings", defaults.measureTimings);
+	//the same range the configuration menu takes
+	Options.scanMilliseconds = ReadNumber(key, L"ScanMilliseconds", defaults.scanMilliseconds);
+	if (Options.scanMilliseconds <= 0)
+		Options.scanMilliseconds = defaults.scanMilliseconds;
+	else if (Options.scanMilliseconds > MaxScanMilliseconds)
+		Options.scanMilliseconds = MaxScanMilliseconds;
+	Options.autoPopup = ReadOption(key, L"AutoPopup", defaults.autoPopup);
+	Options.autoPopupChars = ReadNumber(key, L"AutoPopupChars", defaults.autoPopupChars);
+	if (Options.autoPopupChars <= 0)
+		Options.autoPopupChars = defaults.autoPopupChars;
+	else if (Options.autoPopupChars > MaxPopupChars)
+		Options.autoPopupChars = MaxPopupChars;
+	//no delay at all is fine, the popup just shows at once
+	Options.autoPopupDelay = ReadNumber(key, L"AutoPopupDelay", defaults.autoPopupDelay);
+	if (Options.autoPopupDelay < 0)
+		Options.autoPopupDelay = defaults.autoPopupDelay;
+	else if (Options.autoPopupDelay > MaxPopupDelay)
+		Options.autoPopupDelay = MaxPopupDelay;
+	Options.ghostText = ReadOption(key, L"GhostText", defaults.ghostText);
+	ReadWordDividers(key, Options.wordDividers);
+	RegCloseKey(key);
+}
+
+void SaveSettings()
+{
+	HKEY key;
+	if (SettingsKey.empty() || RegCreateKeyExW(HKEY_CURRENT_USER, SettingsKey.c_str(), 0, NULL, 0,
+		KEY_WRITE, NULL, &key, NULL) != ERROR_SUCCESS)
+	{
+		return;
+	}
+
+	WriteOption(key, L"ProjectWords", Options.projectWords);
+	WriteOption(key, L"MeasureTimings", Options.measureTimings);
+	WriteNumber(key, L"ScanMilliseconds", Options.scanMilliseconds);
+	WriteOption(key, L"AutoPopup", Options.autoPopup);
+	WriteNumber(key, L"AutoPopupChars", Options.autoPopupChars);
+	WriteNumber(key, L"AutoPopupDelay", Options.autoPopupDelay);
+	WriteOption(key, L"GhostText", Options.ghostText);
+	RegCloseKey(key);
+}
+
+bool ReadOption(HKEY key, const wchar_t *name, bool defaultValue)
+{
+	DWORD value;
+	DWORD type;
+	DWORD size = sizeof(value);
+	if (RegQueryValueExW(key, name, NULL, &type, (BYTE *)&value, &size) != ERROR_SUCCESS || type != REG_DWORD)
+		return defaultValue;
+	return value != 0;
+}
+
+void WriteOption(HKEY key, const wchar_t *name, bool value)
+{
+	DWORD data = value ? 1 : 0;
+	RegSetValueExW(key, name, 0, REG_DWORD, (const BYTE *)&data, sizeof(data));
+}
+
+int ReadNumber(HKEY key, const wchar_t *name, int defaultValue)
+{
+	DWORD value;
+	DWORD type;
+	DWORD size = sizeof(value);
+	if (RegQueryValueExW(key, name, NULL, &type, (BYTE *)&value, &size) != ERROR_SUCCESS || type != REG_DWORD)
+		return defaultValue;
+	return (int)value;
+}
+
+void WriteNumber(HKEY key, const wchar_t *name, int value)
+{
+	DWORD data = (DWORD)value;
+	RegSetValueExW(key, name, 0, REG_DWORD, (const BYTE *)&data, sizeof(data));
+}
+
+//only read, they are edited in the registry
+void ReadWordDividers(HKEY key, std::map<wstring, wstring> &wordDividers)
+{
+	wordDividers.clear();
+	HKEY dividersKey;
+	if (RegOpenKeyExW(key, L"WordDividers", 0, KEY_READ, &dividersKey) != ERROR_SUCCESS)
+		return;
+
+	wchar_t name[MAX_PATH];
+	wchar_t value[1024];
+	for (DWORD index = 0; ; index++)
+	{
+		DWORD nameLength = sizeof(name) / sizeof(name[0]);
+		DWORD size = sizeof(value) - sizeof(value[0]);
+		DWORD type;
+		LONG result = RegEnumValueW(dividersKey, index, name, &nameLength, NULL, &type, (BYTE *)value, &size);
+		if (result == ERROR_NO_MORE_ITEMS)
+			break;
+		if (result != ERROR_SUCCESS || type != REG_SZ)
+			continue;
+
+		value[size / sizeof(value[0])] = 0;
+		CharLowerBuffW(name, nameLength);
+		wordDividers[wstring(name, nameLength)] = value;
+	}
+	RegCloseKey(dividersKey);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <map>
+
+// Options kept in the registry under HKCU\<FAR's key for plugins>\WordsComplete.
+struct Settings
+{
+	Settings();
+
+	//also offer the words of the other files in the project of the edited file
+	bool projectWords;
+	//keep latency histograms of completion requests
+	bool measureTimings;
+	//how long completion may read the lines around the cursor before the index is ready
+	int scanMilliseconds;
+	//offer the words while typing, without the hotkey
+	bool autoPopup;
+	//letters of a word typed before they are offered
+	int autoPopupChars;
+	//how long the keyboard has to be quiet before they are offered
+	int autoPopupDelay;
+	//show the rest of the best word after the cursor while typing, Tab writes it
+	bool ghostText;
+	//word dividers to use instead of FAR's by file extension, lower case and
+	//without the dot; kept as string values under the WordDividers subkey
+	std::map<std::wstring, std::wstring> wordDividers;
+};
+
+//more scan time than this and the editor would seem to hang
+const int MaxScanMilliseconds = 1000;
+//longer words are hardly ever typed, the popup would never show
+const int MaxPopupChars = 32;
+//a popup later than this comes after the user has moved on
+const int MaxPopupDelay = 5000;
+
+extern Settings Options;
+
+void LoadSettings(const std::wstring &rootKey);
+void SaveSettings();
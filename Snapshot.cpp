@@ -0,0 +1,214 @@
+#include "stdafx.h"
+#include "Snapshot.h"
+#include "WordIndex.h"
+
+using std::wstring;
+using std::vector;
+
+wstring LowerCase(const wstring &text);
+wstring SnapshotFileName(const wstring &path);
+void SetHeaderStamp(SnapshotHeader &header, const FileStamp &stamp, unsigned int delimiters);
+bool HasSameStamp(const SnapshotHeader &header, const SnapshotHeader &stamp);
+unsigned int Checksum(const unsigned char *data, size_t size, unsigned int checksum);
+bool WriteAll(HANDLE file, const void *data, size_t size);
+
+static wstring SnapshotsFolder;
+
+const unsigned int ChecksumSeed = 2166136261u;
+
+void SetSnapshotsFolder(const wstring &folder)
+{
+	SnapshotsFolder = folder;
+}
+
+bool HasSnapshot(const wstring &fileName, const FileStamp &fileStamp, unsigned int delimiters)
+{
+	wstring path = LowerCase(fileName);
+	SnapshotHeader stamp;
+	SetHeaderStamp(stamp, fileStamp, delimiters);
+
+	HANDLE file = CreateFileW(SnapshotFileName(path).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	SnapshotHeader header;
+	DWORD read = 0;
+	DWORD size = GetFileSize(file, NULL);
+	bool valid = ReadFile(file, &header, sizeof(header), &read, NULL) && read == sizeof(header)
+		&& HasSameStamp(header, stamp) && header.pathLength == path.length()
+		&& size == sizeof(header) + header.pathLength * sizeof(wchar_t) + header.payloadSize;
+	CloseHandle(file);
+	return valid;
+}
+
+bool SaveSnapshot(const wstring &fileName, const FileStamp &stamp, unsigned int delimiters, const WordIndex &index)
+{
+	wstring path = LowerCase(fileName);
+	if (SnapshotsFolder.empty() || path.empty())
+		return false;
+
+	SnapshotHeader header;
+	SetHeaderStamp(header, stamp, delimiters);
+	vector<unsigned char> payload;
+	index.Save(payload);
+	header.pathLength = (unsigned int)path.length();
+	header.payloadSize = (unsigned int)payload.size();
+	header.checksum = Checksum((const unsigned char *)path.c_str(), path.length() * sizeof(wchar_t), ChecksumSeed);
+	header.checksum = Checksum(&payload[0], payload.size(), header.checksum);
+
+	//write next to the old snapshot and swap them, so a reader never sees half a file
+	CreateDirectoryW(SnapshotsFolder.c_str(), NULL);
+	wstring snapshotName = SnapshotFileName(path);
+	wstring temporaryName = snapshotName + L".tmp";
+	HANDLE file = CreateFileW(temporaryName.c_str(), GENERIC_WRITE, 0, NULL,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool written = WriteAll(file, &header, sizeof(header))
+		&& WriteAll(file, path.c_str(), path.length() * sizeof(wchar_t))
+		&& WriteAll(file, &payload[0], payload.size());
+	CloseHandle(file);
+	if (!written || !MoveFileExW(temporaryName.c_str(), snapshotName.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileW(temporaryName.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool LoadSnapshot(const wstring &fileName, const FileStamp &fileStamp, unsigned int delimiters, WordIndex &index)
+{
+	wstring path = LowerCase(fileName);
+	SnapshotHeader stamp;
+	SetHeaderStamp(stamp, fileStamp, delimiters);
+
+	HANDLE file = CreateFileW(SnapshotFileName(path).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD size = GetFileSize(file, NULL);
+	const unsigned char *view = NULL;
+	HANDLE mapping = NULL;
+	if (size != INVALID_FILE_SIZE && size >= sizeof(SnapshotHeader))
+		mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+	{
+		view = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (view == NULL)
+		return false;
+
+	const SnapshotHeader *header = (const SnapshotHeader *)view;
+	const unsigned char *storedPath = view + sizeof(SnapshotHeader);
+	const unsigned char *payload = storedPath + header->pathLength * sizeof(wchar_t);
+	bool loaded = HasSameStamp(*header, stamp) && header->pathLength == path.length()
+		&& size == sizeof(SnapshotHeader) + header->pathLength * sizeof(wchar_t) + header->payloadSize
+		&& memcmp(storedPath, path.c_str(), path.length() * sizeof(wchar_t)) == 0
+		&& Checksum(storedPath, size - sizeof(SnapshotHeader), ChecksumSeed) == header->checksum
+		&& index.Load(payload, header->payloadSize);
+	UnmapViewOfFile(view);
+	return loaded;
+}
+
+void AppendBytes(vector<unsigned char> &data, const void *bytes, size_t size)
+{
+	const unsigned char *first = (const unsigned char *)bytes;
+	data.insert(data.end(), first, first + size);
+}
+
+bool ReadBytes(const unsigned char *&data, const unsigned char *end, void *bytes, size_t size)
+{
+	if (size > (size_t)(end - data))
+		return false;
+
+	std::copy(data, data + size, (unsigned char *)bytes);
+	data += size;
+	return true;
+}
+
+wstring LowerCase(const wstring &text)
+{
+	wstring lower = text;
+	if (!lower.empty())
+		CharLowerBuffW(&lower[0], (DWORD)lower.length());
+	return lower;
+}
+
+wstring SnapshotFileName(const wstring &path)
+{
+	//64-bit FNV-1a of the path; the header keeps the whole path to tell collisions apart
+	unsigned __int64 hash = 14695981039346656037ull;
+	for (size_t i = 0; i < path.length(); i++)
+	{
+		hash ^= (unsigned short)path[i];
+		hash *= 1099511628211ull;
+	}
+
+	const wchar_t *digits = L"0123456789abcdef";
+	wstring name = SnapshotsFolder;
+	for (int shift = 60; shift >= 0; shift -= 4)
+		name += digits[(hash >> shift) & 0xF];
+	return name + L".wci";
+}
+
+bool GetFileStamp(const wstring &fileName, FileStamp &stamp)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (fileName.empty() || !GetFileAttributesExW(fileName.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+
+	stamp.sizeLow = attributes.nFileSizeLow;
+	stamp.sizeHigh = attributes.nFileSizeHigh;
+	stamp.lastWriteLow = attributes.ftLastWriteTime.dwLowDateTime;
+	stamp.lastWriteHigh = attributes.ftLastWriteTime.dwHighDateTime;
+	return true;
+}
+
+bool IsSameFileStamp(const FileStamp &stamp, const FileStamp &other)
+{
+	return stamp.sizeLow == other.sizeLow && stamp.sizeHigh == other.sizeHigh
+		&& stamp.lastWriteLow == other.lastWriteLow && stamp.lastWriteHigh == other.lastWriteHigh;
+}
+
+void SetHeaderStamp(SnapshotHeader &header, const FileStamp &stamp, unsigned int delimiters)
+{
+	memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+	header.checksum = 0;
+	header.fileSizeLow = stamp.sizeLow;
+	header.fileSizeHigh = stamp.sizeHigh;
+	header.lastWriteLow = stamp.lastWriteLow;
+	header.lastWriteHigh = stamp.lastWriteHigh;
+	header.delimiters = delimiters;
+	header.pathLength = 0;
+	header.payloadSize = 0;
+}
+
+bool HasSameStamp(const SnapshotHeader &header, const SnapshotHeader &stamp)
+{
+	return memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) == 0
+		&& header.fileSizeLow == stamp.fileSizeLow && header.fileSizeHigh == stamp.fileSizeHigh
+		&& header.lastWriteLow == stamp.lastWriteLow && header.lastWriteHigh == stamp.lastWriteHigh
+		&& header.delimiters == stamp.delimiters;
+}
+
+unsigned int Checksum(const unsigned char *data, size_t size, unsigned int checksum)
+{
+	//32-bit FNV-1a, carried on from the previous part
+	for (size_t i = 0; i < size; i++)
+	{
+		checksum ^= data[i];
+		checksum *= 16777619u;
+	}
+	return checksum;
+}
+
+bool WriteAll(HANDLE file, const void *data, size_t size)
+{
+	DWORD written = 0;
+	return size == 0 || (WriteFile(file, data, (DWORD)size, &written, NULL) && written == size);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class WordIndex;
+
+// Index of a closed file kept in <plugin folder>\Cache, so reopening a big file
+// doesn't have to read every line through the editor API again. A snapshot is
+// stamped with the size and modification time the file had when the editor
+// read or wrote the indexed lines, and used while the file keeps them and the
+// words are divided the way they were then.
+//
+// File layout, all numbers little-endian:
+//   SnapshotHeader
+//   the full path of the file in lower case, pathLength wchar_t
+//   payloadSize bytes written by WordIndex::Save
+// The checksum covers the path and the payload.
+struct SnapshotHeader
+{
+	char magic[4];
+	unsigned int checksum;
+	unsigned int fileSizeLow;
+	unsigned int fileSizeHigh;
+	unsigned int lastWriteLow;
+	unsigned int lastWriteHigh;
+	//Delimiters::stamp of the table the words were found with
+	unsigned int delimiters;
+	unsigned int pathLength;
+	unsigned int payloadSize;
+};
+
+const char SnapshotMagic[4] = { 'W', 'C', 'I', '3' };
+
+// Size and modification time of a file on disk.
+struct FileStamp
+{
+	unsigned int sizeLow;
+	unsigned int sizeHigh;
+	unsigned int lastWriteLow;
+	unsigned int lastWriteHigh;
+};
+
+void SetSnapshotsFolder(const std::wstring &folder);
+
+bool GetFileStamp(const std::wstring &fileName, FileStamp &stamp);
+bool IsSameFileStamp(const FileStamp &stamp, const FileStamp &other);
+
+//Only compares the header with the stamp, cheap enough for the main thread
+bool HasSnapshot(const std::wstring &fileName, const FileStamp &stamp, unsigned int delimiters);
+bool SaveSnapshot(const std::wstring &fileName, const FileStamp &stamp, unsigned int delimiters, const WordIndex &index);
+bool LoadSnapshot(const std::wstring &fileName, const FileStamp &stamp, unsigned int delimiters, WordIndex &index);
+
+//Raw copies for the parts of the index to save and load themselves
+void AppendBytes(std::vector<unsigned char> &data, const void *bytes, size_t size);
+bool ReadBytes(const unsigned char *&data, const unsigned char *end, void *bytes, size_t size);
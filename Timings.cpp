@@ -0,0 +1,328 @@
+#include "stdafx.h"
+#include "Timings.h"
+#include <stdio.h>
+
+using std::wstring;
+using std::vector;
+
+LONGLONG Now();
+unsigned int Microseconds(LONGLONG ticks);
+void BeginEditorCall();
+void EndEditorCall();
+void EndPhase(LONGLONG now);
+
+const wchar_t *PhaseNames[PhasesCount] = {
+	L"file words", L"project words", L"dictionaries", L"typos", L"menu", L"write",
+	L"editor calls", L"total" };
+
+static bool Enabled = false;
+static bool InRequest = false;
+static LONGLONG Frequency = 0;
+static LONGLONG RequestStart;
+static LONGLONG PhaseStart;
+static int CurrentPhase = -1;
+static LONGLONG MenuTicks;
+static LONGLONG EditorCallStart;
+static LONGLONG EditorTicks;
+static unsigned int EditorCalls;
+static Histogram Phases[PhasesCount];
+static Histogram CallsPerRequest;
+
+Histogram::Histogram()
+{
+	Clear();
+}
+
+void Histogram::Clear()
+{
+	for (int i = 0; i < BucketsCount; i++)
+		counts[i] = 0;
+	count = 0;
+	max = 0;
+	sum = 0;
+}
+
+void Histogram::Add(unsigned int value)
+{
+	counts[Bucket(value)]++;
+	count++;
+	if (value > max)
+		max = value;
+	sum += value;
+}
+
+unsigned int Histogram::Count() const
+{
+	return count;
+}
+
+unsigned int Histogram::Max() const
+{
+	return max;
+}
+
+double Histogram::Mean() const
+{
+	return count == 0 ? 0 : sum / count;
+}
+
+unsigned int Histogram::Percentile(double percent) const
+{
+	double target = count * percent / 100;
+	double seen = 0;
+	for (int bucket = 0; bucket < BucketsCount; bucket++)
+	{
+		seen += counts[bucket];
+		if (counts[bucket] != 0 && seen >= target)
+			return BucketTop(bucket) < max ? BucketTop(bucket) : max;
+	}
+	return max;
+}
+
+//values below SubBuckets get a bucket each, larger ones one of SubBuckets
+//per power of two, chosen by the bits that follow the highest one
+int Histogram::Bucket(unsigned int value)
+{
+	if (value < SubBuckets)
+		return (int)value;
+
+	int exponent = 3;
+	while ((value >> exponent) > 1)
+		exponent++;
+	int subBucket = (int)(value >> (exponent - 3)) & (SubBuckets - 1);
+	return (exponent - 2) * SubBuckets + subBucket;
+}
+
+unsigned int Histogram::BucketTop(int bucket)
+{
+	if (bucket < SubBuckets)
+		return (unsigned int)bucket;
+
+	int exponent = bucket / SubBuckets + 2;
+	unsigned int lowest = (unsigned int)(SubBuckets + bucket % SubBuckets) << (exponent - 3);
+	return lowest + ((1u << (exponent - 3)) - 1);
+}
+
+TimedEditorHost::TimedEditorHost(EditorHost &host)
+	: host(host)
+{
+}
+
+void TimedEditorHost::GetInfo(EditorInfo &editorInfo)
+{
+	BeginEditorCall();
+	host.GetInfo(editorInfo);
+	EndEditorCall();
+}
+
+EditorGetString TimedEditorHost::GetLine(int lineNumber)
+{
+	BeginEditorCall();
+	EditorGetString line = host.GetLine(lineNumber);
+	EndEditorCall();
+	return line;
+}
+
+wstring TimedEditorHost::GetFileName()
+{
+	BeginEditorCall();
+	wstring fileName = host.GetFileName();
+	EndEditorCall();
+	return fileName;
+}
+
+void TimedEditorHost::SetPosition(const EditorSetPosition &position)
+{
+	BeginEditorCall();
+	host.SetPosition(position);
+	EndEditorCall();
+}
+
+void TimedEditorHost::InsertText(const wchar_t *text)
+{
+	BeginEditorCall();
+	host.InsertText(text);
+	EndEditorCall();
+}
+
+void TimedEditorHost::DeleteChar()
+{
+	BeginEditorCall();
+	host.DeleteChar();
+	EndEditorCall();
+}
+
+void TimedEditorHost::UndoRedo(int command)
+{
+	BeginEditorCall();
+	host.UndoRedo(command);
+	EndEditorCall();
+}
+
+void TimedEditorHost::Redraw()
+{
+	BeginEditorCall();
+	host.Redraw();
+	EndEditorCall();
+}
+
+void TimedEditorHost::AddColor(const EditorColor &color)
+{
+	BeginEditorCall();
+	host.AddColor(color);
+	EndEditorCall();
+}
+
+int TimedEditorHost::Menu(MenuItems &items, int x, int y)
+{
+	//the menu waits for the user, it has a phase of its own instead
+	return host.Menu(items, x, y);
+}
+
+int TimedEditorHost::PopupMenu(MenuItems &items, int x, int y, wchar_t &typed)
+{
+	return host.PopupMenu(items, x, y, typed);
+}
+
+TimedRequest::TimedRequest()
+{
+	if (!Enabled)
+		return;
+
+	InRequest = true;
+	RequestStart = Now();
+	CurrentPhase = -1;
+	MenuTicks = 0;
+	EditorTicks = 0;
+	EditorCalls = 0;
+}
+
+TimedRequest::~TimedRequest()
+{
+	if (!Enabled || !InRequest)
+		return;
+
+	LONGLONG now = Now();
+	EndPhase(now);
+	InRequest = false;
+	//the user's time in the menu would drown everything else
+	Phases[PhaseTotal].Add(Microseconds(now - RequestStart - MenuTicks));
+	Phases[PhaseEditorCalls].Add(Microseconds(EditorTicks));
+	CallsPerRequest.Add(EditorCalls);
+}
+
+void EnableTimings(bool enable)
+{
+	Enabled = enable;
+	InRequest = false;
+	if (Frequency == 0)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		Frequency = frequency.QuadPart;
+	}
+}
+
+bool TimingsEnabled()
+{
+	return Enabled;
+}
+
+void BeginPhase(TimingPhase phase)
+{
+	if (!InRequest)
+		return;
+
+	LONGLONG now = Now();
+	EndPhase(now);
+	CurrentPhase = phase;
+	PhaseStart = now;
+}
+
+void ResetTimings()
+{
+	for (int i = 0; i < PhasesCount; i++)
+		Phases[i].Clear();
+	CallsPerRequest.Clear();
+}
+
+wstring FormatTimings()
+{
+	wstring report = L"Completion timings, microseconds\r\n\r\n";
+	if (!Enabled)
+		report += L"Timing is off, it can be turned on in the plugin configuration.\r\n\r\n";
+
+	wchar_t line[200];
+	_snwprintf(line, sizeof(line) / sizeof(line[0]), L"%-14ls %8ls %10ls %10ls %10ls %10ls %10ls\r\n",
+		L"phase", L"count", L"p50", L"p90", L"p99", L"max", L"mean");
+	report += line;
+	for (int i = 0; i < PhasesCount; i++)
+	{
+		const Histogram &phase = Phases[i];
+		_snwprintf(line, sizeof(line) / sizeof(line[0]), L"%-14ls %8u %10u %10u %10u %10u %10.0f\r\n",
+			PhaseNames[i], phase.Count(), phase.Percentile(50), phase.Percentile(90),
+			phase.Percentile(99), phase.Max(), phase.Mean());
+		report += line;
+	}
+
+	_snwprintf(line, sizeof(line) / sizeof(line[0]), L"\r\n%-14ls %8u %10u %10u %10u %10u %10.1f\r\n",
+		L"calls/request", CallsPerRequest.Count(), CallsPerRequest.Percentile(50), CallsPerRequest.Percentile(90),
+		CallsPerRequest.Percentile(99), CallsPerRequest.Max(), CallsPerRequest.Mean());
+	report += line;
+	return report;
+}
+
+bool SaveTimings(const wstring &fileName)
+{
+	wstring report = FormatTimings();
+	int length = WideCharToMultiByte(CP_UTF8, 0, report.c_str(), (int)report.length(), NULL, 0, NULL, NULL);
+	vector<char> bytes(length + 1);
+	WideCharToMultiByte(CP_UTF8, 0, report.c_str(), (int)report.length(), &bytes[0], length, NULL, NULL);
+
+	HANDLE file = CreateFileW(fileName.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+	bool saved = WriteFile(file, &bytes[0], length, &written, NULL) && written == (DWORD)length;
+	CloseHandle(file);
+	return saved;
+}
+
+LONGLONG Now()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+unsigned int Microseconds(LONGLONG ticks)
+{
+	LONGLONG microseconds = ticks * 1000000 / Frequency;
+	return microseconds > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned int)microseconds;
+}
+
+void BeginEditorCall()
+{
+	if (InRequest)
+		EditorCallStart = Now();
+}
+
+void EndEditorCall()
+{
+	if (!InRequest)
+		return;
+	EditorTicks += Now() - EditorCallStart;
+	EditorCalls++;
+}
+
+void EndPhase(LONGLONG now)
+{
+	if (CurrentPhase < 0)
+		return;
+
+	if (CurrentPhase == PhaseMenu)
+		MenuTicks += now - PhaseStart;
+	Phases[CurrentPhase].Add(Microseconds(now - PhaseStart));
+	CurrentPhase = -1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "EditorHost.h"
+
+// Where the time of completion requests goes. Every phase keeps an HDR-style
+// histogram of microseconds: eight buckets per power of two, so percentiles
+// are exact to 12.5% at any scale from a few kilobytes of counters.
+enum TimingPhase
+{
+	PhaseFileWords,
+	PhaseProjectWords,
+	PhaseDictionaries,
+	PhaseTypos,
+	PhaseMenu,
+	PhaseWrite,
+	//time inside editor calls, whichever phase made them
+	PhaseEditorCalls,
+	PhaseTotal,
+	PhasesCount
+};
+
+class Histogram
+{
+public:
+	Histogram();
+
+	void Clear();
+	void Add(unsigned int value);
+	unsigned int Count() const;
+	unsigned int Max() const;
+	double Mean() const;
+	//Upper bound of the bucket that holds the percentile
+	unsigned int Percentile(double percent) const;
+
+private:
+	enum { SubBuckets = 8, BucketsCount = 30 * SubBuckets };
+
+	static int Bucket(unsigned int value);
+	static unsigned int BucketTop(int bucket);
+
+	unsigned int counts[BucketsCount];
+	unsigned int count;
+	unsigned int max;
+	double sum;
+};
+
+// Forwards to another host and times every call to it.
+class TimedEditorHost : public EditorHost
+{
+public:
+	explicit TimedEditorHost(EditorHost &host);
+
+	virtual void GetInfo(EditorInfo &editorInfo);
+	virtual EditorGetString GetLine(int lineNumber);
+	virtual std::wstring GetFileName();
+	virtual void SetPosition(const EditorSetPosition &position);
+	virtual void InsertText(const wchar_t *text);
+	virtual void DeleteChar();
+	virtual void UndoRedo(int command);
+	virtual void Redraw();
+	virtual void AddColor(const EditorColor &color);
+	virtual int Menu(MenuItems &items, int x, int y);
+	virtual int PopupMenu(MenuItems &items, int x, int y, wchar_t &typed);
+
+private:
+	EditorHost &host;
+};
+
+// Times one completion request from construction to destruction.
+class TimedRequest
+{
+public:
+	TimedRequest();
+	~TimedRequest();
+};
+
+//Everything below does nothing while timing is off, which costs a test per call
+void EnableTimings(bool enable);
+bool TimingsEnabled();
+//Ends the phase in progress and starts the next one
+void BeginPhase(TimingPhase phase);
+
+void ResetTimings();
+std::wstring FormatTimings();
+//Written as UTF-8
+bool SaveTimings(const std::wstring &fileName);
@@ -0,0 +1,289 @@
+#include "stdafx.h"
+#include "Tokenizer.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define TOKENIZER_SSSE3
+#include <intrin.h>
+#include <tmmintrin.h>
+#endif
+
+void SetDelimiter(Delimiters &delimiters, unsigned int code, bool isDelimiter);
+void FinishDelimiters(Delimiters &delimiters);
+bool IsSurrogate(unsigned int code);
+unsigned int CodePointAt(const wchar_t *text, int pos, int length, int &start);
+
+#ifdef TOKENIZER_SSSE3
+bool PrepareSsse3();
+unsigned int WordCharsMask(const wchar_t *text, int blockStart, int length, const Delimiters &delimiters);
+int LowestBit(unsigned int mask);
+#endif
+
+Delimiters DefaultDelimiters;
+unsigned char ContextUnits[0x10000 / 8];
+
+static bool HasVectorScan = false;
+static bool UseVectorScan = false;
+//spaces and control characters, which every table has
+static unsigned char SpaceBits[0x10000 / 8];
+const int BlockSize = 16;
+//Unicode's stream-safe text has no longer runs of combining marks
+const int MaxExtendRun = 30;
+
+void InitTokenizer()
+{
+	for (unsigned int code = 0; code <= 0xFFFF; code++)
+	{
+		UnicodeClass unicodeClass = GetUnicodeClass(code);
+		SetDelimiter(DefaultDelimiters, code, unicodeClass == UnicodeSpace || unicodeClass == UnicodePunctuation);
+		if (unicodeClass == UnicodeSpace)
+			SpaceBits[code >> 3] |= 1 << (code & 7);
+		else
+			SpaceBits[code >> 3] &= ~(1 << (code & 7));
+		if (IsSurrogate(code) || unicodeClass == UnicodeExtend)
+			ContextUnits[code >> 3] |= 1 << (code & 7);
+		else
+			ContextUnits[code >> 3] &= ~(1 << (code & 7));
+	}
+	DefaultDelimiters.unicodeSupplementary = true;
+	FinishDelimiters(DefaultDelimiters);
+
+	HasVectorScan = false;
+#ifdef TOKENIZER_SSSE3
+	HasVectorScan = PrepareSsse3();
+#endif
+	UseVectorScan = HasVectorScan;
+}
+
+bool EnableVectorScan(bool enable)
+{
+	UseVectorScan = enable && HasVectorScan;
+	return UseVectorScan;
+}
+
+void CompileDelimiters(const wchar_t *dividers, Delimiters &delimiters)
+{
+	memcpy(delimiters.bits, SpaceBits, sizeof(delimiters.bits));
+	//half of a pair would divide every character that shares it
+	for (const wchar_t *divider = dividers; *divider != 0; divider++)
+	{
+		if (!IsSurrogate((unsigned int)*divider) && (unsigned int)*divider <= 0xFFFF)
+			SetDelimiter(delimiters, (unsigned int)*divider, true);
+	}
+	delimiters.unicodeSupplementary = false;
+	FinishDelimiters(delimiters);
+}
+
+void SetDelimiter(Delimiters &delimiters, unsigned int code, bool isDelimiter)
+{
+	if (isDelimiter)
+		delimiters.bits[code >> 3] |= 1 << (code & 7);
+	else
+		delimiters.bits[code >> 3] &= ~(1 << (code & 7));
+}
+
+void FinishDelimiters(Delimiters &delimiters)
+{
+	for (int nibble = 0; nibble < 16; nibble++)
+		delimiters.asciiNibbles[nibble] = 0;
+	for (int code = 0; code < 0x80; code++)
+	{
+		if (IsDelimiter((wchar_t)code, delimiters))
+			delimiters.asciiNibbles[code & 0x0F] |= 1 << (code >> 4);
+	}
+
+	//FNV-1a
+	unsigned int stamp = 2166136261u;
+	for (size_t i = 0; i < sizeof(delimiters.bits); i++)
+		stamp = (stamp ^ delimiters.bits[i]) * 16777619u;
+	delimiters.stamp = (stamp ^ (delimiters.unicodeSupplementary ? 1 : 0)) * 16777619u;
+}
+
+//pos holds a surrogate, a combining mark or a format character that isn't
+//a divider itself; marks take after the character they go with
+bool IsDelimiterInContext(const wchar_t *text, int pos, int length, const Delimiters &delimiters)
+{
+	for (int run = 0; run < MaxExtendRun; run++)
+	{
+		int start;
+		unsigned int code = CodePointAt(text, pos, length, start);
+		if (IsDelimiterCode(code, delimiters))
+			return true;
+		//a lone surrogate stays in the word, as does a mark at the beginning of the line
+		if (GetUnicodeClass(code) != UnicodeExtend || start == 0)
+			return false;
+		pos = start - 1;
+	}
+	return false;
+}
+
+bool IsSurrogate(unsigned int code)
+{
+	return code >= 0xD800 && code <= 0xDFFF;
+}
+
+//the character the code unit at pos belongs to, and where it starts
+unsigned int CodePointAt(const wchar_t *text, int pos, int length, int &start)
+{
+	unsigned int code = (unsigned int)text[pos];
+	start = pos;
+	if (code >= 0xD800 && code <= 0xDBFF && pos + 1 < length)
+	{
+		unsigned int low = (unsigned int)text[pos + 1];
+		if (low >= 0xDC00 && low <= 0xDFFF)
+			return 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+	}
+	else if (code >= 0xDC00 && code <= 0xDFFF && pos > 0)
+	{
+		unsigned int high = (unsigned int)text[pos - 1];
+		if (high >= 0xD800 && high <= 0xDBFF)
+		{
+			start = pos - 1;
+			return 0x10000 + ((high - 0xD800) << 10) + (code - 0xDC00);
+		}
+	}
+	return code;
+}
+
+WordScanner::WordScanner(const wchar_t *text, int length, const Delimiters &delimiters)
+	: text(text), length(length), delimiters(delimiters), pos(0),
+	blockStart(-BlockSize), wordStarts(0), wordEnds(0), lastWasWordChar(0), inWord(false), inTail(false)
+{
+}
+
+bool WordScanner::Next(int &wordStart, int &wordEnd)
+{
+	return UseVectorScan ? NextVector(wordStart, wordEnd) : NextScalar(wordStart, wordEnd);
+}
+
+bool WordScanner::NextScalar(int &wordStart, int &wordEnd)
+{
+	while (pos < length && IsDelimiter(text, pos, length, delimiters))
+		pos++;
+	if (pos >= length)
+		return false;
+
+	wordStart = pos;
+	while (pos < length && !IsDelimiter(text, pos, length, delimiters))
+		pos++;
+	wordEnd = pos;
+	return true;
+}
+
+#ifdef TOKENIZER_SSSE3
+
+// Classifies 16 code units at once. ASCII characters are looked up with two
+// PSHUFB nibble tables, the first one the table's asciiNibbles: the low nibble
+// selects the set of high nibbles that make a delimiter with it. Non-ASCII lanes
+// are rare and go through IsDelimiter one by one, with the line around them for
+// pairs and marks, so the result always matches the scalar scan.
+
+static __m128i HighNibbleBits;
+
+bool PrepareSsse3()
+{
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 1);
+	if ((cpuInfo[2] & (1 << 9)) == 0)
+		return false;
+
+	unsigned char highNibble[16];
+	for (int nibble = 0; nibble < 16; nibble++)
+		highNibble[nibble] = nibble < 8 ? (unsigned char)(1 << nibble) : 0;
+	HighNibbleBits = _mm_loadu_si128((const __m128i *)highNibble);
+	return true;
+}
+
+//bit N is set when text[blockStart + N] belongs to a word
+unsigned int WordCharsMask(const wchar_t *text, int blockStart, int length, const Delimiters &delimiters)
+{
+	__m128i lowNibbleDelimiters = _mm_loadu_si128((const __m128i *)delimiters.asciiNibbles);
+	__m128i first = _mm_loadu_si128((const __m128i *)(text + blockStart));
+	__m128i second = _mm_loadu_si128((const __m128i *)(text + blockStart + 8));
+	__m128i bytes = _mm_packus_epi16(first, second);
+
+	__m128i lowNibbles = _mm_and_si128(bytes, _mm_set1_epi8(0x0F));
+	__m128i highNibbles = _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+	__m128i delimiterBytes = _mm_and_si128(
+		_mm_shuffle_epi8(lowNibbleDelimiters, lowNibbles),
+		_mm_shuffle_epi8(HighNibbleBits, highNibbles));
+	unsigned int words = _mm_movemask_epi8(_mm_cmpeq_epi8(delimiterBytes, _mm_setzero_si128()));
+
+	//packing saturates 0x80..0x7FFF to 0xFF and turns 0x8000 and above into zero
+	__m128i wide = _mm_packs_epi16(
+		_mm_cmplt_epi16(first, _mm_setzero_si128()), 
+		_mm_cmplt_epi16(second, _mm_setzero_si128()));
+	unsigned int nonAscii = (_mm_movemask_epi8(bytes) | _mm_movemask_epi8(wide)) & 0xFFFF;
+	//zero is a delimiter, so the lanes are word characters until IsDelimiter says otherwise
+	words |= nonAscii;
+	for (int i = 0; nonAscii != 0; i++, nonAscii >>= 1)
+	{
+		if ((nonAscii & 1) && IsDelimiter(text, blockStart + i, length, delimiters))
+			words &= ~(1 << i);
+	}
+	return words;
+}
+
+int LowestBit(unsigned int mask)
+{
+	unsigned long bit;
+	_BitScanForward(&bit, mask);
+	return (int)bit;
+}
+
+bool WordScanner::NextVector(int &wordStart, int &wordEnd)
+{
+	while (!inTail)
+	{
+		if (!inWord && wordStarts != 0)
+		{
+			wordStart = blockStart + LowestBit(wordStarts);
+			wordStarts &= wordStarts - 1;
+			inWord = true;
+		}
+		if (inWord && wordEnds != 0)
+		{
+			wordEnd = blockStart + LowestBit(wordEnds);
+			wordEnds &= wordEnds - 1;
+			inWord = false;
+			return true;
+		}
+
+		if (blockStart + 2 * BlockSize > length)
+		{
+			pos = blockStart + BlockSize;
+			inTail = true;
+		}
+		else
+			ClassifyNextBlock();
+	}
+
+	//the rest of the line is shorter than a block
+	if (inWord)
+	{
+		while (pos < length && !IsDelimiter(text, pos, length, delimiters))
+			pos++;
+		wordEnd = pos;
+		inWord = false;
+		return true;
+	}
+	return NextScalar(wordStart, wordEnd);
+}
+
+void WordScanner::ClassifyNextBlock()
+{
+	blockStart += BlockSize;
+	unsigned int wordChars = WordCharsMask(text, blockStart, length, delimiters);
+	unsigned int previous = (wordChars << 1) | lastWasWordChar;
+	wordStarts = wordChars & ~previous & 0xFFFF;
+	wordEnds = ~wordChars & previous & 0xFFFF;
+	lastWasWordChar = (wordChars >> (BlockSize - 1)) & 1;
+}
+
+#else
+
+bool WordScanner::NextVector(int &wordStart, int &wordEnd)
+{
+	return NextScalar(wordStart, wordEnd);
+}
+
+#endif
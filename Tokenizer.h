@@ -0,0 +1,97 @@
+#pragma once
+
+#include "UnicodeTables.h"
+
+// The characters that divide words, one bit per UTF-16 code unit. Every editor
+// compiles its own from FAR's word dividers; the default one follows the
+// Unicode classes. Surrogates, combining marks and format characters can't be
+// told apart one code unit at a time, so they have no bit of their own and are
+// looked at together with the characters around them.
+struct Delimiters
+{
+	unsigned char bits[0x10000 / 8];
+	//for the vector scan: per low nibble of an ASCII character, the bits of
+	//the high nibbles that make a delimiter with it
+	unsigned char asciiNibbles[16];
+	//whether characters beyond the BMP divide words by their Unicode class;
+	//FAR's dividers can't name them, so its tables leave them in words
+	bool unicodeSupplementary;
+	//tells tables apart, so an index is only reused with the table it was made with
+	unsigned int stamp;
+};
+
+//Filled by InitTokenizer from the Unicode classes: spaces, punctuation and
+//symbols divide words
+extern Delimiters DefaultDelimiters;
+//Surrogates and the code units of the UnicodeExtend class
+extern unsigned char ContextUnits[0x10000 / 8];
+
+void InitTokenizer();
+//The vector scan is on wherever the CPU has it; with it off every scanner
+//takes the scalar loop. Returns whether the vector scan is on.
+bool EnableVectorScan(bool enable);
+//Spaces and control characters are always delimiters, the rest only when
+//they are among the dividers
+void CompileDelimiters(const wchar_t *dividers, Delimiters &delimiters);
+bool IsDelimiterInContext(const wchar_t *text, int pos, int length, const Delimiters &delimiters);
+
+inline bool IsDelimiterCode(unsigned int code, const Delimiters &delimiters)
+{
+	if (code > 0xFFFF)
+		return delimiters.unicodeSupplementary && GetUnicodeClass(code) >= UnicodeSpace;
+	return (delimiters.bits[code >> 3] & (1 << (code & 7))) != 0;
+}
+
+//A single code unit, such as a typed character: a surrogate or a combining
+//mark is taken for a part of a word
+inline bool IsDelimiter(wchar_t ch, const Delimiters &delimiters)
+{
+	return IsDelimiterCode((unsigned int)ch, delimiters);
+}
+
+inline bool NeedsContext(unsigned int code)
+{
+	if (code > 0xFFFF)
+		return GetUnicodeClass(code) == UnicodeExtend;
+	return (ContextUnits[code >> 3] & (1 << (code & 7))) != 0;
+}
+
+//The code unit at pos of a line: a surrogate is classified as the character
+//of its pair, a combining mark as the character it goes with
+inline bool IsDelimiter(const wchar_t *text, int pos, int length, const Delimiters &delimiters)
+{
+	unsigned int code = (unsigned int)text[pos];
+	if (IsDelimiterCode(code, delimiters))
+		return true;
+	//ASCII has no context to look at, which keeps the usual text to a lookup and a test
+	if (code < 0x80 || !NeedsContext(code))
+		return false;
+	return IsDelimiterInContext(text, pos, length, delimiters);
+}
+
+// Iterates over the words of a line right in its buffer, without copying.
+// Where the CPU allows, characters are classified 16 at a time.
+class WordScanner
+{
+public:
+	WordScanner(const wchar_t *text, int length, const Delimiters &delimiters);
+	bool Next(int &wordStart, int &wordEnd);
+
+private:
+	bool NextScalar(int &wordStart, int &wordEnd);
+	bool NextVector(int &wordStart, int &wordEnd);
+	void ClassifyNextBlock();
+
+	const wchar_t *text;
+	int length;
+	const Delimiters &delimiters;
+	int pos;
+
+	//state of the vector scan: bits of the current block where words start and end
+	int blockStart;
+	unsigned int wordStarts;
+	unsigned int wordEnds;
+	unsigned int lastWasWordChar;
+	bool inWord;
+	bool inTail;
+};
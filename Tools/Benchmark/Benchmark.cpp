@@ -0,0 +1,268 @@
+// Benchmark.cpp : Measures how long WordsComplete takes from the hotkey to the written word.
+//
+// Usage: Benchmark [lines ...]
+// Every size gets a generated buffer that looks like source code. Completions are
+// requested at random words, first before the index is ready, then with it.
+// Then the search around the cursor reads the whole largest buffer with one
+// scan thread, two, and so on up to one a processor. Last the scalar and the
+// vector scan of the tokenizer are checked against each other on random lines,
+// and split the largest buffer into words again and again.
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wctype.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "MemoryEditorHost.h"
+#include "TokenizerBenchmark.h"
+#include "../../Completion.h"
+#include "../../Indexer.h"
+#include "../../Tokenizer.h"
+#include "../../ParallelScan.h"
+#include "../../Settings.h"
+
+using std::wstring;
+using std::vector;
+
+struct Latencies
+{
+	double p50;
+	double p99;
+	double max;
+};
+
+void Generate(int linesCount, vector<wstring> &lines);
+wstring Identifier(unsigned int number);
+unsigned int Random();
+bool PickWord(const wstring &line, int &position);
+Latencies MeasureCompletions(MemoryEditorHost &host, EditorState &state, bool fuzzy);
+void MeasureScanScaling(int linesCount);
+double Milliseconds(const LARGE_INTEGER &start, const LARGE_INTEGER &end);
+void OnJobDone(IndexJob *job);
+
+const int RequestsCount = 1000;
+const int ScalingRequests = 5;
+const int ScanComparisonLines = 100000;
+const unsigned int VocabularySize = 20000;
+
+static unsigned int Seed = 1;
+static HANDLE JobDoneEvent = NULL;
+static IndexJob *DoneJob = NULL;
+
+int wmain(int argc, wchar_t *argv[])
+{
+	vector<int> sizes;
+	for (int i = 1; i < argc; i++)
+		sizes.push_back(_wtoi(argv[i]));
+	if (sizes.empty())
+	{
+		sizes.push_back(1000);
+		sizes.push_back(10000);
+		sizes.push_back(100000);
+		sizes.push_back(1000000);
+	}
+
+	InitTokenizer();
+	JobDoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	StartIndexer(OnJobDone);
+	StartScanThreads(DefaultScanThreads());
+
+	wprintf(L"%10ls %-14ls %10ls %10ls %10ls\n", L"lines", L"completion", L"p50 ms", L"p99 ms", L"max ms");
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		MemoryEditorHost host(L"Benchmark.cpp", 50);
+		Generate(sizes[i], host.Lines());
+		EditorState state;
+
+		Latencies cold = MeasureCompletions(host, state, false);
+		wprintf(L"%10d %-14ls %10.3f %10.3f %10.3f\n", sizes[i], L"cold", cold.p50, cold.p99, cold.max);
+		Latencies coldFuzzy = MeasureCompletions(host, state, true);
+		wprintf(L"%10d %-14ls %10.3f %10.3f %10.3f\n", sizes[i], L"cold fuzzy", coldFuzzy.p50, coldFuzzy.p99, coldFuzzy.max);
+
+		//the same way the plugin does it: lines are read here, tokenized on the indexer thread
+		EditorInfo editorInfo;
+		host.GetInfo(editorInfo);
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+		StartIndexing(host, editorInfo, state);
+		WaitForSingleObject(JobDoneEvent, INFINITE);
+		InstallIndex(state, *DoneJob);
+		delete DoneJob;
+		QueryPerformanceCounter(&end);
+		wprintf(L"%10d %-14ls %10.3f\n", sizes[i], L"indexing", Milliseconds(start, end));
+
+		Latencies warm = MeasureCompletions(host, state, false);
+		wprintf(L"%10d %-14ls %10.3f %10.3f %10.3f\n", sizes[i], L"indexed", warm.p50, warm.p99, warm.max);
+		Latencies warmFuzzy = MeasureCompletions(host, state, true);
+		wprintf(L"%10d %-14ls %10.3f %10.3f %10.3f\n", sizes[i], L"indexed fuzzy", warmFuzzy.p50, warmFuzzy.p99, warmFuzzy.max);
+	}
+
+	StopScanThreads();
+	int largest = *std::max_element(sizes.begin(), sizes.end());
+	MeasureScanScaling(largest);
+	vector<wstring> lines;
+	Generate(largest, lines);
+	bool scansAgree = CompareScans(ScanComparisonLines);
+	MeasureTokenizer(lines);
+	StopIndexer();
+	CloseHandle(JobDoneEvent);
+	return scansAgree ? 0 : 1;
+}
+
+Latencies MeasureCompletions(MemoryEditorHost &host, EditorState &state, bool fuzzy)
+{
+	vector<wstring> &lines = host.Lines();
+	vector<double> times;
+	while ((int)times.size() < RequestsCount)
+	{
+		int lineNumber = Random() % lines.size();
+		int position;
+		if (!PickWord(lines[lineNumber], position))
+			continue;
+
+		//put the line back afterwards, so every request sees the same buffer
+		wstring original = lines[lineNumber];
+		host.SetCursor(lineNumber, position);
+		LARGE_INTEGER start, end;
+		QueryPerformanceCounter(&start);
+		EditorInfo editorInfo;
+		host.GetInfo(editorInfo);
+		CompleteWord(host, editorInfo, state, fuzzy);
+		QueryPerformanceCounter(&end);
+		lines[lineNumber] = original;
+		times.push_back(Milliseconds(start, end));
+	}
+
+	std::sort(times.begin(), times.end());
+	Latencies latencies;
+	latencies.p50 = times[times.size() * 50 / 100];
+	latencies.p99 = times[times.size() * 99 / 100];
+	latencies.max = times.back();
+	return latencies;
+}
+
+//the beginning is none of the generated words', so every line gets read,
+//and too short for a search of typos afterwards
+void MeasureScanScaling(int linesCount)
+{
+	MemoryEditorHost host(L"Benchmark.cpp", 50);
+	Generate(linesCount, host.Lines());
+	host.Lines().push_back(L"qq");
+	host.SetCursor(linesCount, 2);
+	int scanMilliseconds = Options.scanMilliseconds;
+	Options.scanMilliseconds = 60 * 1000;
+
+	wprintf(L"\n%10ls %-14ls %10ls %10ls\n", L"lines", L"scan threads", L"p50 ms", L"speedup");
+	double oneThread = 0;
+	for (int threads = 1; threads <= DefaultScanThreads() + 1; threads++)
+	{
+		StartScanThreads(threads - 1);
+		EditorState state;
+		vector<double> times;
+		for (int i = 0; i < ScalingRequests; i++)
+		{
+			LARGE_INTEGER start, end;
+			QueryPerformanceCounter(&start);
+			EditorInfo editorInfo;
+			host.GetInfo(editorInfo);
+			CompleteWord(host, editorInfo, state, false);
+			QueryPerformanceCounter(&end);
+			times.push_back(Milliseconds(start, end));
+		}
+		StopScanThreads();
+
+		std::sort(times.begin(), times.end());
+		double p50 = times[times.size() / 2];
+		if (threads == 1)
+			oneThread = p50;
+		wprintf(L"%10d %-14d %10.3f %10.2f\n", linesCount, threads, p50, oneThread / p50);
+	}
+	Options.scanMilliseconds = scanMilliseconds;
+}
+
+//the cursor goes one to three characters into a random word of the line
+bool PickWord(const wstring &line, int &position)
+{
+	vector<int> starts;
+	WordScanner scanner(line.c_str(), (int)line.length(), DefaultDelimiters);
+	int wordStart, wordEnd;
+	while (scanner.Next(wordStart, wordEnd))
+	{
+		if (wordEnd - wordStart > 3)
+			starts.push_back(wordStart);
+	}
+	if (starts.empty())
+		return false;
+
+	position = starts[Random() % starts.size()] + 1 + Random() % 3;
+	return true;
+}
+
+void Generate(int linesCount, vector<wstring> &lines)
+{
+	const wchar_t *keywords[] = { L"if", L"for", L"return", L"while", L"const", L"int", L"else" };
+	const wchar_t *separators[] = { L" = ", L"(", L", ", L"); ", L"->", L" + ", L"." };
+	const int keywordsCount = sizeof(keywords) / sizeof(keywords[0]);
+	const int separatorsCount = sizeof(separators) / sizeof(separators[0]);
+
+	lines.resize(linesCount);
+	for (int i = 0; i < linesCount; i++)
+	{
+		wstring &line = lines[i];
+		line.assign(Random() % 4, L'\t');
+		if (Random() % 8 == 0)
+			continue;
+
+		if (Random() % 3 == 0)
+			line += wstring(keywords[Random() % keywordsCount]) + L" ";
+		int tokens = 2 + Random() % 6;
+		for (int j = 0; j < tokens; j++)
+		{
+			//squaring skews the choice towards the front of the vocabulary, as in real code
+			unsigned int pick = Random() % VocabularySize;
+			line += Identifier((unsigned int)((unsigned __int64)pick * pick / VocabularySize));
+			line += separators[Random() % separatorsCount];
+		}
+	}
+}
+
+wstring Identifier(unsigned int number)
+{
+	const wchar_t *syllables[] = {
+		L"get", L"set", L"word", L"line", L"index", L"count", L"node", L"text", L"item",
+		L"menu", L"state", L"editor", L"file", L"name", L"size", L"buffer", L"position",
+		L"find", L"next", L"last", L"first", L"match", L"prefix", L"result", L"value" };
+	const unsigned int syllablesCount = sizeof(syllables) / sizeof(syllables[0]);
+
+	wstring name = syllables[number % syllablesCount];
+	number /= syllablesCount;
+	while (number > 0)
+	{
+		wstring syllable = syllables[number % syllablesCount];
+		syllable[0] = towupper(syllable[0]);
+		name += syllable;
+		number /= syllablesCount;
+	}
+	return name;
+}
+
+unsigned int Random()
+{
+	Seed = Seed * 1103515245 + 12345;
+	return Seed >> 8;
+}
+
+double Milliseconds(const LARGE_INTEGER &start, const LARGE_INTEGER &end)
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return (double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+void OnJobDone(IndexJob *job)
+{
+	DoneJob = job;
+	SetEvent(JobDoneEvent);
+}
@@ -0,0 +1,126 @@
+#include <windows.h>
+#include <string.h>
+#include "MemoryEditorHost.h"
+
+using std::wstring;
+using std::vector;
+
+MemoryEditorHost::MemoryEditorHost(const wstring &fileName, int windowSizeY)
+	: fileName(fileName), windowSizeY(windowSizeY), curLine(0), curPos(0), topScreenLine(0), menusShown(0),
+	undoLine(-1)
+{
+}
+
+vector<wstring> &MemoryEditorHost::Lines()
+{
+	return lines;
+}
+
+void MemoryEditorHost::SetCursor(int line, int position)
+{
+	curLine = line;
+	curPos = position;
+	//keep the cursor in the middle of the window, like FAR does after a jump
+	topScreenLine = line > windowSizeY / 2 ? line - windowSizeY / 2 : 0;
+}
+
+int MemoryEditorHost::MenusShown() const
+{
+	return menusShown;
+}
+
+void MemoryEditorHost::GetInfo(EditorInfo &editorInfo)
+{
+	memset(&editorInfo, 0, sizeof(editorInfo));
+	editorInfo.EditorID = 1;
+	editorInfo.WindowSizeX = 80;
+	editorInfo.WindowSizeY = windowSizeY;
+	editorInfo.TotalLines = (int)lines.size();
+	editorInfo.CurLine = curLine;
+	editorInfo.CurPos = curPos;
+	editorInfo.CurTabPos = curPos;
+	editorInfo.TopScreenLine = topScreenLine;
+	editorInfo.TabSize = 8;
+}
+
+EditorGetString MemoryEditorHost::GetLine(int lineNumber)
+{
+	if (lineNumber < 0)
+		lineNumber = curLine;
+
+	EditorGetString line;
+	line.StringNumber = lineNumber;
+	line.StringText = lines[lineNumber].c_str();
+	line.StringEOL = L"\r\n";
+	line.StringLength = (int)lines[lineNumber].length();
+	line.SelStart = -1;
+	line.SelEnd = 0;
+	return line;
+}
+
+wstring MemoryEditorHost::GetFileName()
+{
+	return fileName;
+}
+
+void MemoryEditorHost::SetPosition(const EditorSetPosition &position)
+{
+	if (position.CurLine >= 0)
+		curLine = position.CurLine;
+	if (position.CurPos >= 0)
+		curPos = position.CurPos;
+	if (position.TopScreenLine >= 0)
+		topScreenLine = position.TopScreenLine;
+}
+
+void MemoryEditorHost::InsertText(const wchar_t *text)
+{
+	wstring &line = lines[curLine];
+	//FAR pads the line with spaces when the cursor stands beyond its end
+	if (curPos > (int)line.length())
+		line.resize(curPos, L' ');
+	size_t length = wcslen(text);
+	line.insert(curPos, text, length);
+	curPos += (int)length;
+}
+
+void MemoryEditorHost::DeleteChar()
+{
+	wstring &line = lines[curLine];
+	if (curPos < (int)line.length())
+		line.erase(curPos, 1);
+}
+
+void MemoryEditorHost::UndoRedo(int command)
+{
+	if (command == EUR_BEGIN)
+	{
+		undoLine = curLine;
+		undoText = lines[curLine];
+	}
+	else if (command == EUR_UNDO && undoLine >= 0 && undoLine < (int)lines.size())
+	{
+		lines[undoLine] = undoText;
+		undoLine = -1;
+	}
+}
+
+void MemoryEditorHost::Redraw()
+{
+}
+
+void MemoryEditorHost::AddColor(const EditorColor &color)
+{
+}
+
+int MemoryEditorHost::Menu(MenuItems &items, int x, int y)
+{
+	menusShown++;
+	return items.Fetch(1) == 0 ? -1 : 0;
+}
+
+int MemoryEditorHost::PopupMenu(MenuItems &items, int x, int y, wchar_t &typed)
+{
+	typed = 0;
+	return Menu(items, x, y);
+}
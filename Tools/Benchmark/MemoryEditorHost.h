@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "../../EditorHost.h"
+
+// Editor over lines kept in memory, with a cursor and a window like FAR's.
+// Menus always pick their first item.
+class MemoryEditorHost : public EditorHost
+{
+public:
+	MemoryEditorHost(const std::wstring &fileName, int windowSizeY);
+
+	std::vector<std::wstring> &Lines();
+	void SetCursor(int line, int position);
+	int MenusShown() const;
+
+	virtual void GetInfo(EditorInfo &editorInfo);
+	virtual EditorGetString GetLine(int lineNumber);
+	virtual std::wstring GetFileName();
+	virtual void SetPosition(const EditorSetPosition &position);
+	virtual void InsertText(const wchar_t *text);
+	virtual void DeleteChar();
+	virtual void UndoRedo(int command);
+	virtual void Redraw();
+	virtual void AddColor(const EditorColor &color);
+	virtual int Menu(MenuItems &items, int x, int y);
+	virtual int PopupMenu(MenuItems &items, int x, int y, wchar_t &typed);
+
+private:
+	std::vector<std::wstring> lines;
+	std::wstring fileName;
+	int windowSizeY;
+	int curLine;
+	int curPos;
+	int topScreenLine;
+	int menusShown;
+	//the line with the cursor as it was before the last step of undo began,
+	//the completion changes no other
+	int undoLine;
+	std::wstring undoText;
+};
@@ -0,0 +1,172 @@
+#include <windows.h>
+#include <stdio.h>
+#include <locale>
+#include <string>
+#include <vector>
+#include "TokenizerBenchmark.h"
+#include "../../Tokenizer.h"
+
+using std::wstring;
+using std::vector;
+
+typedef unsigned int (*CountWords)(const wstring &line);
+typedef vector<std::pair<int, int> > WordSpans;
+
+double MeasureThroughput(const vector<wstring> &lines, CountWords countWords, unsigned int &words);
+unsigned int CountWordsByLocale(const wstring &line);
+unsigned int CountWordsByTable(const wstring &line);
+bool IsDelimiterByLocale(wchar_t ch);
+bool CompareScans(const wstring &line, const Delimiters &delimiters);
+WordSpans ScanWords(const wstring &line, const Delimiters &delimiters);
+wstring RandomLine();
+//from Benchmark.cpp
+unsigned int Random();
+
+//enough passes for a run to take a good part of a second
+const size_t MeasuredCharacters = 16 * 1024 * 1024;
+
+void MeasureTokenizer(const vector<wstring> &lines)
+{
+	wprintf(L"\n%-20ls %10ls %12ls\n", L"tokenizer", L"MB/s", L"words");
+	unsigned int words;
+	double locale = MeasureThroughput(lines, CountWordsByLocale, words);
+	wprintf(L"%-20ls %10.1f %12u\n", L"locale per char", locale, words);
+	EnableVectorScan(false);
+	double scalar = MeasureThroughput(lines, CountWordsByTable, words);
+	wprintf(L"%-20ls %10.1f %12u\n", L"table scalar", scalar, words);
+	if (EnableVectorScan(true))
+	{
+		double vector = MeasureThroughput(lines, CountWordsByTable, words);
+		wprintf(L"%-20ls %10.1f %12u\n", L"table SSSE3", vector, words);
+	}
+	else
+		wprintf(L"%-20ls %10ls\n", L"table SSSE3", L"no SSSE3");
+}
+
+bool CompareScans(int linesCount)
+{
+	if (!EnableVectorScan(true))
+	{
+		wprintf(L"\nNo SSSE3, the scalar scan has nothing to be compared with\n");
+		return true;
+	}
+
+	//FAR's default word dividers
+	Delimiters farDelimiters;
+	CompileDelimiters(L"~!%^&*()+|{}:\"<>?`-=\\[];',./", farDelimiters);
+	for (int i = 0; i < linesCount; i++)
+	{
+		wstring line = RandomLine();
+		if (!CompareScans(line, DefaultDelimiters) || !CompareScans(line, farDelimiters))
+		{
+			wprintf(L"\nThe scalar and the SSSE3 scan split line %d differently:\n", i);
+			for (size_t j = 0; j < line.length(); j++)
+				wprintf(L"%04X ", (unsigned int)line[j]);
+			wprintf(L"\n");
+			return false;
+		}
+	}
+	wprintf(L"\nThe scalar and the SSSE3 scan split %d random lines alike\n", linesCount);
+	return true;
+}
+
+bool CompareScans(const wstring &line, const Delimiters &delimiters)
+{
+	EnableVectorScan(false);
+	WordSpans scalar = ScanWords(line, delimiters);
+	EnableVectorScan(true);
+	return ScanWords(line, delimiters) == scalar;
+}
+
+WordSpans ScanWords(const wstring &line, const Delimiters &delimiters)
+{
+	WordSpans words;
+	WordScanner scanner(line.c_str(), (int)line.length(), delimiters);
+	int wordStart, wordEnd;
+	while (scanner.Next(wordStart, wordEnd))
+		words.push_back(std::make_pair(wordStart, wordEnd));
+	return words;
+}
+
+//long enough for several blocks and a tail, with every kind of code unit the
+//vector scan treats apart: ASCII, 0x80..0x7FFF, 0x8000 and above, surrogates
+//alone and in pairs, combining marks and NUL
+wstring RandomLine()
+{
+	const wchar_t characters[] = {
+		L'a', L'Z', L'7', L'_', L' ', L'\t', L'.', L'-', L'$', L'(', L'\0',
+		0x00E9, 0x0301, 0x0430, 0x2014, 0x3000, 0x4E2D, 0xAC00, 0xD55C, 0xE000, 0xFEFF, 0xFF01,
+		0xD835, 0xDC00, 0xD83D, 0xDE00 };
+	const unsigned int charactersCount = sizeof(characters) / sizeof(characters[0]);
+
+	//runs of one character, of one to eight
+	size_t length = Random() % 100;
+	wstring line;
+	while (line.length() < length)
+		line.append(1 + Random() % 8, characters[Random() % charactersCount]);
+	line.resize(length);
+	return line;
+}
+
+//megabytes of wchar_t a second; words are the count of one pass, so the
+//ways of tokenizing can be checked against each other
+double MeasureThroughput(const vector<wstring> &lines, CountWords countWords, unsigned int &words)
+{
+	size_t characters = 0;
+	for (size_t i = 0; i < lines.size(); i++)
+		characters += lines[i].length();
+	if (characters == 0)
+		return 0;
+
+	LARGE_INTEGER start, end;
+	QueryPerformanceCounter(&start);
+	int passes = 0;
+	do
+	{
+		words = 0;
+		for (size_t i = 0; i < lines.size(); i++)
+			words += countWords(lines[i]);
+		passes++;
+	}
+	while (passes * characters < MeasuredCharacters);
+	QueryPerformanceCounter(&end);
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	double seconds = (double)(end.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+	return passes * characters * sizeof(wchar_t) / seconds / (1024 * 1024);
+}
+
+unsigned int CountWordsByLocale(const wstring &line)
+{
+	unsigned int words = 0;
+	size_t pos = 0;
+	while (pos < line.length())
+	{
+		while (pos < line.length() && IsDelimiterByLocale(line[pos]))
+			pos++;
+		if (pos == line.length())
+			break;
+		while (pos < line.length() && !IsDelimiterByLocale(line[pos]))
+			pos++;
+		words++;
+	}
+	return words;
+}
+
+unsigned int CountWordsByTable(const wstring &line)
+{
+	unsigned int words = 0;
+	WordScanner scanner(line.c_str(), (int)line.length(), DefaultDelimiters);
+	int wordStart, wordEnd;
+	while (scanner.Next(wordStart, wordEnd))
+		words++;
+	return words;
+}
+
+//the way IsDelimiter used to be: a locale and two facet calls a character
+bool IsDelimiterByLocale(wchar_t ch)
+{
+	std::locale defaultLocale;
+	return std::isspace(ch, defaultLocale) || (ch != L'_' && std::ispunct(ch, defaultLocale));
+}
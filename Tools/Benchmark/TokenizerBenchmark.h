@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//Tokenizes the lines over and over and prints MB/s of UTF-16 text, for the
+//scalar and the vector scan and for the locale calls they replaced
+void MeasureTokenizer(const std::vector<std::wstring> &lines);
+//Splits random lines of mixed scripts with the scalar and the vector scan,
+//false when they disagree somewhere
+bool CompareScans(int linesCount);
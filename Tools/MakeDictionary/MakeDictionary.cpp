@@ -0,0 +1,99 @@
+// MakeDictionary.cpp : Builds a .wcd dictionary for WordsComplete out of word lists.
+//
+// Usage: MakeDictionary output.wcd words.txt [more.txt ...]
+// Word lists are UTF-8 or UTF-16 text with words separated by white space.
+
+#include <windows.h>
+#include <stdio.h>
+#include <wctype.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "../../Dictionary.h"
+
+using std::wstring;
+using std::vector;
+
+bool ReadWords(const wchar_t *fileName, vector<wstring> &words);
+wstring DecodeText(const vector<char> &bytes);
+
+int wmain(int argc, wchar_t *argv[])
+{
+	if (argc < 3)
+	{
+		fwprintf(stderr, L"Usage: MakeDictionary output.wcd words.txt [more.txt ...]\n");
+		return 1;
+	}
+
+	vector<wstring> words;
+	for (int i = 2; i < argc; i++)
+	{
+		if (!ReadWords(argv[i], words))
+		{
+			fwprintf(stderr, L"Can't read %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+
+	if (!WriteDictionary(argv[1], words))
+	{
+		fwprintf(stderr, L"Can't write %s\n", argv[1]);
+		return 1;
+	}
+	wprintf(L"%s: %u words\n", argv[1], (unsigned int)words.size());
+	return 0;
+}
+
+bool ReadWords(const wchar_t *fileName, vector<wstring> &words)
+{
+	FILE *file = _wfopen(fileName, L"rb");
+	if (file == NULL)
+		return false;
+
+	vector<char> bytes;
+	char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+
+	wstring text = DecodeText(bytes);
+	size_t pos = 0;
+	while (pos < text.length())
+	{
+		while (pos < text.length() && iswspace(text[pos]))
+			pos++;
+		size_t start = pos;
+		while (pos < text.length() && !iswspace(text[pos]))
+			pos++;
+
+		//lengths are stored in a single wchar_t
+		if (pos > start && pos - start <= 0xFFFF)
+			words.push_back(text.substr(start, pos - start));
+	}
+	return true;
+}
+
+wstring DecodeText(const vector<char> &bytes)
+{
+	if (bytes.size() >= 2 && (unsigned char)bytes[0] == 0xFF && (unsigned char)bytes[1] == 0xFE)
+		return wstring((const wchar_t *)&bytes[2], (bytes.size() - 2) / sizeof(wchar_t));
+
+	size_t start = 0;
+	if (bytes.size() >= 3 && (unsigned char)bytes[0] == 0xEF
+		&& (unsigned char)bytes[1] == 0xBB && (unsigned char)bytes[2] == 0xBF)
+	{
+		start = 3;
+	}
+	if (start == bytes.size())
+		return wstring();
+
+	int length = MultiByteToWideChar(CP_UTF8, 0, &bytes[start], (int)(bytes.size() - start), NULL, 0);
+	wstring text(length, L' ');
+	if (length > 0)
+		MultiByteToWideChar(CP_UTF8, 0, &bytes[start], (int)(bytes.size() - start), &text[0], length);
+	return text;
+}
@@ -0,0 +1,146 @@
+// MakeUnicodeTables.cpp : Writes the tables of character classes WordsComplete divides words by.
+//
+// Usage: MakeUnicodeTables UnicodeData.txt ..\..\UnicodeTables.cpp version
+// UnicodeData.txt comes from the Unicode Character Database, its version goes
+// to the head of the written file.
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "../../UnicodeTables.h"
+
+using std::string;
+using std::vector;
+using std::map;
+
+bool ReadClasses(const wchar_t *fileName, vector<unsigned char> &classes);
+UnicodeClass ClassOf(unsigned int code, const string &category);
+bool WriteTables(const wchar_t *fileName, const wchar_t *version, const vector<unsigned char> &classes);
+
+const unsigned int CodePointsCount = 0x110000;
+const unsigned int BlockSize = 256;
+const unsigned int BlocksCount = CodePointsCount / BlockSize;
+
+int wmain(int argc, wchar_t *argv[])
+{
+	if (argc != 4)
+	{
+		fwprintf(stderr, L"Usage: MakeUnicodeTables UnicodeData.txt UnicodeTables.cpp version\n");
+		return 1;
+	}
+
+	//code points UnicodeData.txt doesn't list are unassigned, and left in words
+	vector<unsigned char> classes(CodePointsCount, UnicodeWord);
+	if (!ReadClasses(argv[1], classes))
+	{
+		fwprintf(stderr, L"Can't read %ls\n", argv[1]);
+		return 1;
+	}
+	if (!WriteTables(argv[2], argv[3], classes))
+	{
+		fwprintf(stderr, L"Can't write %ls\n", argv[2]);
+		return 1;
+	}
+	return 0;
+}
+
+//lines are code;name;general category;... and the big ranges are two lines,
+//named <..., First> and <..., Last>
+bool ReadClasses(const wchar_t *fileName, vector<unsigned char> &classes)
+{
+	FILE *file = _wfopen(fileName, L"rt");
+	if (file == NULL)
+		return false;
+
+	char line[1024];
+	unsigned int rangeStart = 0;
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		char *name = strchr(line, ';');
+		char *category = name != NULL ? strchr(name + 1, ';') : NULL;
+		if (category == NULL)
+			continue;
+
+		unsigned int code = strtoul(line, NULL, 16);
+		string categoryName(category + 1, 2);
+		if (code >= CodePointsCount)
+			continue;
+
+		string nameText(name + 1, category);
+		if (nameText.find(", First>") != string::npos)
+		{
+			rangeStart = code;
+			continue;
+		}
+		unsigned int first = nameText.find(", Last>") != string::npos ? rangeStart : code;
+		for (unsigned int i = first; i <= code; i++)
+			classes[i] = (unsigned char)ClassOf(i, categoryName);
+	}
+	fclose(file);
+	return true;
+}
+
+UnicodeClass ClassOf(unsigned int code, const string &category)
+{
+	//the byte order mark is no part of the text
+	if (code == 0xFEFF)
+		return UnicodeSpace;
+	if (category[0] == 'M' || category == "Cf")
+		return UnicodeExtend;
+	if (category[0] == 'Z' || category == "Cc")
+		return UnicodeSpace;
+	if ((category[0] == 'P' && category != "Pc") || category[0] == 'S')
+		return UnicodePunctuation;
+	//letters, numbers, the underscore and the like, private use and surrogates
+	return UnicodeWord;
+}
+
+//same blocks are written once, four classes to a byte
+bool WriteTables(const wchar_t *fileName, const wchar_t *version, const vector<unsigned char> &classes)
+{
+	vector<unsigned char> blockIndex(BlocksCount);
+	vector<vector<unsigned char> > blocks;
+	map<vector<unsigned char>, unsigned char> known;
+	for (unsigned int block = 0; block < BlocksCount; block++)
+	{
+		vector<unsigned char> packed(BlockSize / 4, 0);
+		for (unsigned int i = 0; i < BlockSize; i++)
+			packed[i / 4] |= (unsigned char)(classes[block * BlockSize + i] << (i % 4 * 2));
+
+		map<vector<unsigned char>, unsigned char>::const_iterator found = known.find(packed);
+		if (found == known.end())
+		{
+			if (blocks.size() > 0xFF)
+				return false;
+			found = known.insert(std::make_pair(packed, (unsigned char)blocks.size())).first;
+			blocks.push_back(packed);
+		}
+		blockIndex[block] = found->second;
+	}
+
+	FILE *file = _wfopen(fileName, L"wt");
+	if (file == NULL)
+		return false;
+
+	fwprintf(file, L"// Generated by Tools\\MakeUnicodeTables from UnicodeData.txt of Unicode %ls, don't edit.\n\n", version);
+	fwprintf(file, L"#include \"stdafx.h\"\n#include \"UnicodeTables.h\"\n\n");
+	fwprintf(file, L"const unsigned char UnicodeBlocks[0x110000 / 256] = {");
+	for (unsigned int block = 0; block < BlocksCount; block++)
+		fwprintf(file, L"%ls%u,", block % 16 == 0 ? L"\n\t" : L" ", blockIndex[block]);
+	fwprintf(file, L"\n};\n\n");
+
+	fwprintf(file, L"const unsigned char UnicodeClasses[%u][256 / 4] = {\n", (unsigned int)blocks.size());
+	for (size_t block = 0; block < blocks.size(); block++)
+	{
+		fwprintf(file, L"\t{");
+		for (unsigned int i = 0; i < blocks[block].size(); i++)
+			fwprintf(file, L"%ls0x%02X,", i % 16 == 0 ? L"\n\t\t" : L" ", blocks[block][i]);
+		fwprintf(file, L"\n\t},\n");
+	}
+	fwprintf(file, L"};\n");
+	return fclose(file) == 0;
+}
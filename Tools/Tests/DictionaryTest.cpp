@@ -0,0 +1,204 @@
+// Dictionaries are written the way MakeDictionary writes them, mapped back and
+// searched, and what they find is compared with a plain search of the words.
+
+#include <windows.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Tests.h"
+#include "../../Dictionary.h"
+
+using std::wstring;
+using std::vector;
+
+vector<wstring> MakeWords();
+vector<wstring> WordsLikeThis(const vector<wstring> &words, const wstring &prefix, int maxCount);
+void TestSearches(const wstring &folder);
+void TestBadFiles(const wstring &folder);
+void TestFolders(const wstring &folder);
+
+void TestDictionary()
+{
+	wstring folder = MakeTempFolder(L"Dictionary");
+	if (!CHECK(!folder.empty()))
+		return;
+
+	TestSearches(folder);
+	TestBadFiles(folder);
+	TestFolders(folder);
+}
+
+void TestSearches(const wstring &folder)
+{
+	vector<wstring> words = MakeWords();
+	wstring fileName = folder + L"words.wcd";
+	if (!CHECK(WriteDictionary(fileName, words)))
+		return;
+
+	Dictionary dictionary;
+	if (!CHECK(dictionary.Open(fileName)))
+		return;
+
+	//every word's every prefix, so block borders get searched from both sides,
+	//and prefixes before, between and after the words
+	vector<wstring> prefixes;
+	for (size_t i = 0; i < words.size(); i++)
+	{
+		for (size_t length = 0; length <= words[i].length(); length++)
+			prefixes.push_back(words[i].substr(0, length));
+	}
+	prefixes.push_back(L"A");
+	prefixes.push_back(L"getz");
+	prefixes.push_back(L"zzz");
+
+	const int maxCounts[] = { 1, 5, DictionaryBlockSize + 1, 1000 };
+	int mismatches = 0;
+	for (size_t i = 0; i < prefixes.size(); i++)
+	{
+		for (size_t j = 0; j < sizeof(maxCounts) / sizeof(maxCounts[0]); j++)
+		{
+			vector<wstring> found;
+			dictionary.FindWordsLikeThis(prefixes[i], maxCounts[j], found);
+			if (found != WordsLikeThis(words, prefixes[i], maxCounts[j]))
+				mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+
+	//words already found stay in front of the new ones
+	vector<wstring> found(1, L"first");
+	dictionary.FindWordsLikeThis(L"get", 2, found);
+	CHECK(found.size() == 3 && found[0] == L"first");
+
+	vector<wstring> empty;
+	CHECK(WriteDictionary(folder + L"empty.wcd", empty));
+	Dictionary emptyDictionary;
+	CHECK(emptyDictionary.Open(folder + L"empty.wcd"));
+	emptyDictionary.FindWordsLikeThis(L"", 10, found);
+	CHECK(found.size() == 3);
+}
+
+//a header alone, a wrong magic, block offsets past the end of the file and
+//a file cut in the middle of the words must neither open wrong nor crash a search
+void TestBadFiles(const wstring &folder)
+{
+	Dictionary dictionary;
+	CHECK(!dictionary.Open(folder + L"missing.wcd"));
+
+	CHECK(WriteTextFile(folder + L"short.wcd", "WCD"));
+	CHECK(!dictionary.Open(folder + L"short.wcd"));
+
+	const char wrongMagic[] = "XXXX\1\0\0\0\0\0\0\0";
+	CHECK(WriteBytes(folder + L"magic.wcd", wrongMagic, sizeof(wrongMagic) - 1));
+	CHECK(!dictionary.Open(folder + L"magic.wcd"));
+
+	//one block that says it starts far beyond the file
+	const char farOffset[] = "WCD1\1\0\0\0\1\0\0\0\377\377\0\0";
+	CHECK(WriteBytes(folder + L"offset.wcd", farOffset, sizeof(farOffset) - 1));
+	vector<wstring> found;
+	if (CHECK(dictionary.Open(folder + L"offset.wcd")))
+		dictionary.FindWordsLikeThis(L"", 10, found);
+	CHECK(found.empty());
+
+	//every length of a real dictionary cut short
+	vector<wstring> words = MakeWords();
+	wstring fileName = folder + L"whole.wcd";
+	if (!CHECK(WriteDictionary(fileName, words)))
+		return;
+	FILE *whole = _wfopen(fileName.c_str(), L"rb");
+	if (!CHECK(whole != NULL))
+		return;
+	vector<char> bytes;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), whole)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(whole);
+
+	int wrongWords = 0;
+	for (size_t length = sizeof(DictionaryHeader); length < bytes.size(); length += 7)
+	{
+		wstring cutName = folder + L"cut.wcd";
+		if (!WriteBytes(cutName, &bytes[0], length))
+			continue;
+
+		Dictionary cutDictionary;
+		if (!cutDictionary.Open(cutName))
+			continue;
+		found.clear();
+		cutDictionary.FindWordsLikeThis(L"", (int)words.size(), found);
+		for (size_t i = 0; i < found.size(); i++)
+		{
+			if (!std::binary_search(words.begin(), words.end(), found[i]))
+				wrongWords++;
+		}
+	}
+	CHECK(wrongWords == 0);
+}
+
+//<folder>\<extension>\*.wcd, chosen by the extension of the file whatever its case
+void TestFolders(const wstring &folder)
+{
+	wstring cppFolder = folder + L"cpp\\";
+	if (!CHECK(CreateDirectoryW(cppFolder.c_str(), NULL)))
+		return;
+
+	vector<wstring> keywords;
+	keywords.push_back(L"namespace");
+	keywords.push_back(L"nullptr");
+	vector<wstring> library;
+	library.push_back(L"numeric_limits");
+	CHECK(WriteDictionary(cppFolder + L"keywords.wcd", keywords));
+	CHECK(WriteDictionary(cppFolder + L"library.wcd", library));
+	CHECK(WriteTextFile(cppFolder + L"readme.txt", "not a dictionary"));
+
+	SetDictionariesFolder(folder);
+	const vector<Dictionary *> &dictionaries = GetDictionaries(L"C:\\Project\\Main.CPP");
+	CHECK(dictionaries.size() == 2);
+	vector<wstring> found;
+	for (size_t i = 0; i < dictionaries.size(); i++)
+		dictionaries[i]->FindWordsLikeThis(L"n", 10, found);
+	std::sort(found.begin(), found.end());
+	CHECK(found.size() == 3 && found[0] == L"namespace" && found[2] == L"numeric_limits");
+
+	CHECK(GetDictionaries(L"C:\\Project\\Main.cs").empty());
+	CHECK(GetDictionaries(L"C:\\Project.cpp\\Makefile").empty());
+	//the second time comes from the dictionaries already mapped
+	CHECK(&GetDictionaries(L"other.cpp") == &dictionaries);
+	CloseDictionaries();
+	SetDictionariesFolder(wstring());
+}
+
+//enough words for a good many blocks, sharing prefixes of every length
+vector<wstring> MakeWords()
+{
+	const wchar_t *stems[] = { L"get", L"getValue", L"set", L"size", L"s", L"_", L"item" };
+	const int stemsCount = sizeof(stems) / sizeof(stems[0]);
+	vector<wstring> words;
+	for (int i = 0; i < stemsCount; i++)
+	{
+		words.push_back(stems[i]);
+		for (int j = 0; j < 60; j++)
+		{
+			wchar_t number[16];
+			_snwprintf(number, sizeof(number) / sizeof(number[0]), L"%d", j * 37 % 1000);
+			words.push_back(wstring(stems[i]) + number);
+			words.push_back(wstring(stems[i]) + (wchar_t)(L'A' + j % 26) + number);
+		}
+	}
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+	return words;
+}
+
+vector<wstring> WordsLikeThis(const vector<wstring> &words, const wstring &prefix, int maxCount)
+{
+	vector<wstring> found;
+	for (size_t i = 0; i < words.size() && (int)found.size() < maxCount; i++)
+	{
+		if (words[i].length() > prefix.length() && words[i].compare(0, prefix.length(), prefix) == 0)
+			found.push_back(words[i]);
+	}
+	return found;
+}
@@ -0,0 +1,110 @@
+// A project is made in the temporary folder, indexed by ProjectIndex on its
+// threads and changed under it; the words found are waited for, since the
+// index reads the files and the changes in the background.
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "Tests.h"
+#include "../../ProjectIndex.h"
+
+using std::wstring;
+using std::vector;
+
+void TestProjectRoot(const wstring &folder);
+void TestProjectWords(const wstring &folder);
+bool WaitForWords(ProjectIndex &index, const wchar_t *prefix, const vector<wstring> &expected);
+vector<wstring> Words(const wchar_t *first, const wchar_t *second = NULL);
+
+//a rescan waits for the changes to settle, a second, before it reads them
+const DWORD IndexTimeout = 10 * 1000;
+
+void TestProjectIndex()
+{
+	wstring folder = MakeTempFolder(L"ProjectIndex");
+	if (!CHECK(!folder.empty()))
+		return;
+
+	TestProjectRoot(folder);
+	TestProjectWords(folder);
+}
+
+//the nearest folder with a version control folder or a solution in it
+void TestProjectRoot(const wstring &folder)
+{
+	wstring repository = folder + L"Repository";
+	wstring solution = repository + L"\\Solution";
+	CHECK(CreateDirectoryW(repository.c_str(), NULL));
+	CHECK(CreateDirectoryW((repository + L"\\.hg").c_str(), NULL));
+	CHECK(CreateDirectoryW((repository + L"\\src").c_str(), NULL));
+	CHECK(CreateDirectoryW(solution.c_str(), NULL));
+	CHECK(WriteTextFile(solution + L"\\Solution.sln", ""));
+
+	CHECK(FindProjectRoot(repository + L"\\src\\main.cpp") == repository);
+	CHECK(FindProjectRoot(solution + L"\\main.cpp") == solution);
+	//the second time comes from what was found the first
+	CHECK(FindProjectRoot(repository + L"\\src\\other.cpp") == repository);
+	CHECK(FindProjectRoot(L"main.cpp").empty());
+	CloseProjectIndexes();
+}
+
+void TestProjectWords(const wstring &folder)
+{
+	wstring project = folder + L"Project";
+	CHECK(CreateDirectoryW(project.c_str(), NULL));
+	CHECK(CreateDirectoryW((project + L"\\.git").c_str(), NULL));
+	CHECK(CreateDirectoryW((project + L"\\src").c_str(), NULL));
+	CHECK(CreateDirectoryW((project + L"\\node_modules").c_str(), NULL));
+	CHECK(WriteTextFile(project + L"\\one.txt", "alpha gamma shared"));
+	CHECK(WriteTextFile(project + L"\\src\\two.cpp", "shared sharedOnlyHere;alpha"));
+	CHECK(WriteTextFile(project + L"\\.git\\config", "versionControl"));
+	CHECK(WriteTextFile(project + L"\\node_modules\\module.js", "moduleWord"));
+	const char binary[] = "binaryWord\0\1\2";
+	CHECK(WriteBytes(project + L"\\data.bin", binary, sizeof(binary) - 1));
+	const char utf16[] = "\377\376w\0i\0d\0e\0 \0w\0o\0r\0d\0";
+	CHECK(WriteBytes(project + L"\\wide.txt", utf16, sizeof(utf16) - 1));
+
+	ProjectIndex index(project);
+	CHECK(index.Root() == project);
+	//the words of more files come first
+	CHECK(WaitForWords(index, L"shar", Words(L"shared", L"sharedOnlyHere")));
+	CHECK(WaitForWords(index, L"al", Words(L"alpha")));
+	CHECK(WaitForWords(index, L"wide", Words(L"wideword")));
+	CHECK(WaitForWords(index, L"w", Words(L"wide", L"wideword")));
+	CHECK(WaitForWords(index, L"version", vector<wstring>()));
+	CHECK(WaitForWords(index, L"module", vector<wstring>()));
+	CHECK(WaitForWords(index, L"binary", vector<wstring>()));
+
+	//a changed file's words replace its old ones, a deleted file's go away
+	CHECK(WriteTextFile(project + L"\\one.txt", "alpha delta sharedOnlyHere"));
+	CHECK(WaitForWords(index, L"del", Words(L"delta")));
+	CHECK(WaitForWords(index, L"gam", vector<wstring>()));
+	CHECK(WaitForWords(index, L"shar", Words(L"sharedOnlyHere", L"shared")));
+	CHECK(DeleteFileW((project + L"\\src\\two.cpp").c_str()));
+	CHECK(WaitForWords(index, L"shar", Words(L"sharedOnlyHere")));
+	CHECK(WaitForWords(index, L"al", Words(L"alpha")));
+}
+
+//true as soon as the index finds just these words, false when it doesn't in time
+bool WaitForWords(ProjectIndex &index, const wchar_t *prefix, const vector<wstring> &expected)
+{
+	DWORD start = GetTickCount();
+	for (;;)
+	{
+		vector<wstring> found;
+		index.FindWordsLikeThis(prefix, 10, found);
+		if (found == expected)
+			return true;
+		if (GetTickCount() - start > IndexTimeout)
+			return false;
+		Sleep(50);
+	}
+}
+
+vector<wstring> Words(const wchar_t *first, const wchar_t *second)
+{
+	vector<wstring> words(1, first);
+	if (second != NULL)
+		words.push_back(second);
+	return words;
+}
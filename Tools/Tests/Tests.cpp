@@ -0,0 +1,110 @@
+// Tests.cpp : Checks the parts of WordsComplete that work without FAR.
+//
+// Usage: Tests
+// Every test works in a folder of its own under the temporary folder, all of
+// them are removed at the end. The failed checks are printed, and make the exit code 1.
+
+#include <windows.h>
+#include <stdio.h>
+#include <string>
+#include "Tests.h"
+#include "../../Tokenizer.h"
+
+using std::wstring;
+
+void RemoveTree(const wstring &folder);
+
+static int Checks = 0;
+static int Failures = 0;
+static wstring TempRoot;
+
+int wmain(int argc, wchar_t *argv[])
+{
+	InitTokenizer();
+	TestDictionary();
+	TestProjectIndex();
+	TestWordIndex();
+	TestWordTrie();
+
+	if (!TempRoot.empty())
+		RemoveTree(TempRoot);
+	wprintf(L"%d checks, %d failed\n", Checks, Failures);
+	return Failures == 0 ? 0 : 1;
+}
+
+bool Check(bool condition, const char *text, const char *file, int line)
+{
+	Checks++;
+	if (!condition)
+	{
+		Failures++;
+		wprintf(L"%hs(%d): failed %hs\n", file, line, text);
+	}
+	return condition;
+}
+
+wstring MakeTempFolder(const wchar_t *name)
+{
+	wchar_t tempPath[MAX_PATH];
+	DWORD length = GetTempPathW(MAX_PATH, tempPath);
+	if (length == 0 || length > MAX_PATH)
+		return wstring();
+
+	//the process id keeps two runs at once apart
+	if (TempRoot.empty())
+	{
+		wchar_t unique[32];
+		_snwprintf(unique, sizeof(unique) / sizeof(unique[0]), L"%u", (unsigned int)GetCurrentProcessId());
+		TempRoot = wstring(tempPath) + L"WordsCompleteTests" + unique + L"\\";
+		RemoveTree(TempRoot);
+		if (!CreateDirectoryW(TempRoot.c_str(), NULL))
+		{
+			TempRoot.clear();
+			return wstring();
+		}
+	}
+
+	wstring folder = TempRoot + name + L"\\";
+	if (!CreateDirectoryW(folder.c_str(), NULL))
+		return wstring();
+	return folder;
+}
+
+void RemoveTree(const wstring &folder)
+{
+	WIN32_FIND_DATAW findData;
+	HANDLE find = FindFirstFileW((folder + L"*").c_str(), &findData);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			wstring name = findData.cFileName;
+			if (name == L"." || name == L"..")
+				continue;
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				RemoveTree(folder + name + L"\\");
+			else
+				DeleteFileW((folder + name).c_str());
+		}
+		while (FindNextFileW(find, &findData));
+		FindClose(find);
+	}
+	RemoveDirectoryW(folder.c_str());
+}
+
+bool WriteBytes(const wstring &fileName, const char *bytes, size_t length)
+{
+	HANDLE file = CreateFileW(fileName.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+	bool saved = WriteFile(file, bytes, (DWORD)length, &written, NULL) && written == (DWORD)length;
+	CloseHandle(file);
+	return saved;
+}
+
+bool WriteTextFile(const wstring &fileName, const char *text)
+{
+	return WriteBytes(fileName, text, strlen(text));
+}
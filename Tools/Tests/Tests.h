@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+//Prints the check that failed and where, and counts it
+bool Check(bool condition, const char *text, const char *file, int line);
+#define CHECK(condition) Check((condition), #condition, __FILE__, __LINE__)
+
+//A new empty folder under the temporary one, ending with a backslash, or an
+//empty string when it can't be made
+std::wstring MakeTempFolder(const wchar_t *name);
+bool WriteBytes(const std::wstring &fileName, const char *bytes, size_t length);
+bool WriteTextFile(const std::wstring &fileName, const char *text);
+
+void TestDictionary();
+void TestProjectIndex();
+void TestWordIndex();
+void TestWordTrie();
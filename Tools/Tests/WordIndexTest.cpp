@@ -0,0 +1,78 @@
+// Lines of an index get new words over and over, so it rebuilds its pool a few
+// times, and what it finds is compared with an index of the final lines made at
+// once and with one loaded from what it saved.
+
+#include <windows.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "Tests.h"
+#include "../../WordIndex.h"
+#include "../../Tokenizer.h"
+
+using std::wstring;
+using std::vector;
+
+wstring LineText(int round, int lineNumber);
+bool FindSameWords(const WordIndex &index, const WordIndex &other, int linesCount);
+
+void TestWordIndex()
+{
+	const int linesCount = 200;
+	const int rounds = 100;
+	vector<wstring> lines(linesCount);
+	WordIndex changed;
+	for (int round = 0; round < rounds; round++)
+	{
+		for (int i = 0; i < linesCount; i++)
+		{
+			lines[i] = LineText(round, i);
+			changed.SetLine(i, lines[i].c_str(), (int)lines[i].length(), DefaultDelimiters);
+		}
+	}
+	changed.DeleteLines(50, 50);
+	lines.erase(lines.begin() + 50, lines.begin() + 100);
+
+	WordIndex fresh;
+	for (int i = 0; i < (int)lines.size(); i++)
+		fresh.SetLine(i, lines[i].c_str(), (int)lines[i].length(), DefaultDelimiters);
+	CHECK(changed.LinesCount() == fresh.LinesCount());
+	CHECK(FindSameWords(changed, fresh, (int)lines.size()));
+
+	//the words of the earlier rounds are not saved
+	vector<unsigned char> data, freshData;
+	changed.Save(data);
+	fresh.Save(freshData);
+	CHECK(data.size() < 2 * freshData.size());
+	WordIndex loaded;
+	if (CHECK(loaded.Load(&data[0], data.size())))
+		CHECK(FindSameWords(loaded, fresh, (int)lines.size()));
+}
+
+//a word of the round, one of every round and one of every line
+wstring LineText(int round, int lineNumber)
+{
+	wchar_t text[100];
+	_snwprintf(text, sizeof(text) / sizeof(text[0]), L"round%d_%d(shared, line%d);", round, lineNumber, lineNumber);
+	return text;
+}
+
+bool FindSameWords(const WordIndex &index, const WordIndex &other, int linesCount)
+{
+	const wchar_t *prefixes[] = { L"r", L"round9", L"round99_1", L"sh", L"line", L"line1", L"x" };
+	Arena arena;
+	for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++)
+	{
+		for (int line = 0; line < linesCount; line += 17)
+		{
+			vector<wstring> found = index.GetWordsLikeThis(prefixes[i], line, 20, arena);
+			vector<wstring> otherFound = other.GetWordsLikeThis(prefixes[i], line, 20, arena);
+			arena.Reset();
+			if (found != otherFound)
+				return false;
+		}
+		if (index.GetFuzzyWords(prefixes[i], 20) != other.GetFuzzyWords(prefixes[i], 20))
+			return false;
+	}
+	return true;
+}
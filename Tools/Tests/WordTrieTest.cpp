@@ -0,0 +1,134 @@
+// Words are added to a trie and removed from it at random, and what it counts
+// is compared with a map of the same words; once all of them are removed, the
+// trie has to have let go of its nodes. A saved trie whose nodes are made to
+// loop mustn't load.
+
+#include <windows.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "Tests.h"
+#include "../../WordTrie.h"
+
+using std::map;
+using std::wstring;
+using std::vector;
+
+void TestTrieRemoval();
+void TestTrieLoad();
+wstring RandomWord(unsigned int &seed);
+bool HasSameCounts(const WordTrie &trie, const map<wstring, int> &counts);
+bool LoadChanged(const vector<unsigned char> &data, int node, int field, int value);
+
+void TestWordTrie()
+{
+	TestTrieRemoval();
+	TestTrieLoad();
+}
+
+void TestTrieRemoval()
+{
+	const int operations = 300000;
+	unsigned int seed = 1;
+	WordTrie trie;
+	map<wstring, int> counts;
+	for (int i = 0; i < operations; i++)
+	{
+		wstring word = RandomWord(seed);
+		if (seed % 3 == 0)
+		{
+			trie.Remove(word.c_str(), (int)word.length());
+			map<wstring, int>::iterator found = counts.find(word);
+			if (found != counts.end() && --found->second == 0)
+				counts.erase(found);
+		}
+		else
+		{
+			trie.Add(word.c_str(), (int)word.length());
+			counts[word]++;
+		}
+	}
+	CHECK(trie.WordsCount() == (int)counts.size());
+	CHECK(HasSameCounts(trie, counts));
+
+	//the removed words' nodes don't stay
+	WordTrie fresh;
+	for (map<wstring, int>::const_iterator i = counts.begin(); i != counts.end(); ++i)
+		fresh.Add(i->first.c_str(), (int)i->first.length(), i->second);
+	vector<unsigned char> data, freshData;
+	trie.Save(data);
+	fresh.Save(freshData);
+	CHECK(data.size() < 2 * freshData.size());
+
+	for (map<wstring, int>::const_iterator i = counts.begin(); i != counts.end(); ++i)
+	{
+		for (int j = 0; j < i->second; j++)
+			trie.Remove(i->first.c_str(), (int)i->first.length());
+	}
+	vector<unsigned char> emptyData;
+	data.clear();
+	trie.Save(data);
+	WordTrie().Save(emptyData);
+	CHECK(trie.WordsCount() == 0);
+	CHECK(data.size() == emptyData.size());
+}
+
+void TestTrieLoad()
+{
+	//the root, "a" and below it "b" and "c"
+	WordTrie trie;
+	trie.Add(L"ab", 2);
+	trie.Add(L"ac", 2);
+	vector<unsigned char> data;
+	trie.Save(data);
+
+	const int firstChild = 2, nextSibling = 3, parent = 4;
+	//unchanged, as the parent is the root already
+	CHECK(LoadChanged(data, 1, parent, 0));
+	CHECK(!LoadChanged(data, 3, firstChild, 1));
+	CHECK(!LoadChanged(data, 3, nextSibling, 2));
+	CHECK(!LoadChanged(data, 2, parent, 0));
+	CHECK(!LoadChanged(data, 0, parent, 1));
+}
+
+//short words of a few letters, so that they share their beginnings a lot
+wstring RandomWord(unsigned int &seed)
+{
+	seed = seed * 1103515245 + 12345;
+	unsigned int bits = seed >> 8;
+	int length = 1 + bits % 8;
+	bits /= 8;
+	wstring word;
+	for (int i = 0; i < length; i++)
+	{
+		word += (wchar_t)(L'a' + bits % 4);
+		bits /= 4;
+	}
+	return word;
+}
+
+bool HasSameCounts(const WordTrie &trie, const map<wstring, int> &counts)
+{
+	for (map<wstring, int>::const_iterator i = counts.begin(); i != counts.end(); ++i)
+	{
+		if (trie.Count(i->first.c_str(), (int)i->first.length()) != i->second)
+			return false;
+	}
+	vector<wstring> words;
+	trie.FindWordsLikeThis(L"", (int)counts.size() + 1, words);
+	return words.size() == counts.size();
+}
+
+//the nodes are saved after four counts as they are in memory, ints first
+bool LoadChanged(const vector<unsigned char> &data, int node, int field, int value)
+{
+	unsigned int counts[4];
+	memcpy(counts, &data[0], sizeof(counts));
+	size_t nodeSize = (data.size() - sizeof(counts) - counts[1] * sizeof(wchar_t)) / counts[0];
+
+	vector<unsigned char> changed(data);
+	memcpy(&changed[sizeof(counts) + node * nodeSize + field * sizeof(int)], &value, sizeof(value));
+	WordTrie trie;
+	const unsigned char *start = &changed[0];
+	return trie.Load(start, start + changed.size());
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Classes of Unicode characters, as far as dividing words goes. The tables are
+// written by Tools\MakeUnicodeTables out of the Unicode Character Database:
+// a block number for every 256 code points, and the blocks that are alike
+// stored once, two bits a code point.
+enum UnicodeClass
+{
+	//letters, digits, the underscore, private use and unassigned characters
+	UnicodeWord,
+	//combining marks and format characters, they go with the character before them
+	UnicodeExtend,
+	//spaces, line and paragraph separators and control characters
+	UnicodeSpace,
+	//the rest of punctuation and the symbols
+	UnicodePunctuation
+};
+
+extern const unsigned char UnicodeBlocks[0x110000 / 256];
+extern const unsigned char UnicodeClasses[][256 / 4];
+
+inline UnicodeClass GetUnicodeClass(unsigned int code)
+{
+	if (code > 0x10FFFF)
+		return UnicodeWord;
+	unsigned int low = code & 0xFF;
+	unsigned int classes = UnicodeClasses[UnicodeBlocks[code >> 8]][low >> 2];
+	return (UnicodeClass)((classes >> ((low & 3) * 2)) & 3);
+}
@@ -0,0 +1,299 @@
+#include "stdafx.h"
+#include "WordIndex.h"
+#include "Tokenizer.h"
+#include "Proximity.h"
+#include "Snapshot.h"
+
+using std::wstring;
+using std::vector;
+
+//never a fingerprint of any text
+const unsigned int NoFingerprint = 0;
+//a small pool isn't worth rebuilding however much of it is unused
+const unsigned int MinCompactedWords = 4 * 1024;
+
+void WordIndex::Clear()
+{
+	pool.Clear();
+	lines.clear();
+	fingerprints.clear();
+	words.Clear();
+}
+
+void WordIndex::Swap(WordIndex &other)
+{
+	pool.Swap(other.pool);
+	lines.swap(other.lines);
+	fingerprints.swap(other.fingerprints);
+	words.Swap(other.words);
+}
+
+int WordIndex::LinesCount() const
+{
+	return (int)lines.size();
+}
+
+bool WordIndex::SetLine(int lineNumber, const wchar_t *text, int length, const Delimiters &delimiters)
+{
+	if (lineNumber < 0)
+		return false;
+
+	if (lineNumber >= LinesCount())
+	{
+		lines.resize(lineNumber + 1);
+		fingerprints.resize(lineNumber + 1, NoFingerprint);
+	}
+
+	//most lines the editor passes are the same as before. A line is fingerprinted
+	//from the second time on, indexing a file would spend a fifth of its time on
+	//fingerprints it mostly never needs
+	LineWords &lineWords = lines[lineNumber];
+	if (fingerprints[lineNumber] != NoFingerprint || !lineWords.empty())
+	{
+		unsigned int fingerprint = Fingerprint(text, length);
+		if (fingerprints[lineNumber] == fingerprint)
+			return false;
+		fingerprints[lineNumber] = fingerprint;
+	}
+
+	//the text changed, but maybe only spaces or punctuation were typed
+	if (HasSameWords(lineWords, text, length, delimiters))
+		return false;
+
+	RemoveWords(lineWords);
+	lineWords.clear();
+	WordScanner scanner(text, length, delimiters);
+	int wordStart, wordEnd;
+	while (scanner.Next(wordStart, wordEnd))
+		lineWords.push_back(pool.Intern(text + wordStart, wordEnd - wordStart));
+	AddWords(lineWords);
+	if (pool.Count() > 2 * (unsigned int)words.WordsCount() + MinCompactedWords)
+		CompactPool();
+	return true;
+}
+
+void WordIndex::InsertLines(int lineNumber, int count)
+{
+	if (lineNumber > LinesCount())
+		lineNumber = LinesCount();
+	if (lineNumber < 0 || count <= 0)
+		return;
+
+	lines.insert(lines.begin() + lineNumber, count, LineWords());
+	fingerprints.insert(fingerprints.begin() + lineNumber, count, NoFingerprint);
+}
+
+void WordIndex::DeleteLines(int lineNumber, int count)
+{
+	if (lineNumber < 0 || lineNumber >= LinesCount() || count <= 0)
+		return;
+	if (lineNumber + count > LinesCount())
+		count = LinesCount() - lineNumber;
+
+	for (int i = lineNumber; i < lineNumber + count; i++)
+		RemoveWords(lines[i]);
+	lines.erase(lines.begin() + lineNumber, lines.begin() + lineNumber + count);
+	fingerprints.erase(fingerprints.begin() + lineNumber, fingerprints.begin() + lineNumber + count);
+	if (pool.Count() > 2 * (unsigned int)words.WordsCount() + MinCompactedWords)
+		CompactPool();
+}
+
+void WordIndex::Save(vector<unsigned char> &data) const
+{
+	//words no line uses any more stay out, the rest are numbered anew for that
+	WordPool compacted;
+	vector<unsigned int> newIds;
+	bool compacting = pool.Count() != (unsigned int)words.WordsCount();
+	if (compacting)
+		CompactWords(compacted, newIds);
+
+	//the pool goes first, then the word counts of all lines, then their ids back to back
+	(compacting ? compacted : pool).Save(data);
+	vector<unsigned int> lengths(lines.size() + 1);
+	lengths[0] = (unsigned int)lines.size();
+	for (size_t i = 0; i < lines.size(); i++)
+		lengths[i + 1] = (unsigned int)lines[i].size();
+	AppendBytes(data, &lengths[0], lengths.size() * sizeof(unsigned int));
+	LineWords renumbered;
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		const LineWords *lineWords = &lines[i];
+		if (compacting)
+		{
+			renumbered.resize(lines[i].size());
+			for (size_t j = 0; j < lines[i].size(); j++)
+				renumbered[j] = newIds[lines[i][j]];
+			lineWords = &renumbered;
+		}
+		if (!lineWords->empty())
+			AppendBytes(data, &(*lineWords)[0], lineWords->size() * sizeof(unsigned int));
+	}
+	words.Save(data);
+}
+
+bool WordIndex::Load(const unsigned char *data, size_t size)
+{
+	const unsigned char *end = data + size;
+	WordIndex loaded;
+	if (!loaded.pool.Load(data, end))
+		return false;
+
+	unsigned int linesCount;
+	if (!ReadBytes(data, end, &linesCount, sizeof(linesCount))
+		|| linesCount > (size_t)(end - data) / sizeof(unsigned int))
+	{
+		return false;
+	}
+
+	vector<unsigned int> lengths(linesCount);
+	if (linesCount != 0 && !ReadBytes(data, end, &lengths[0], linesCount * sizeof(unsigned int)))
+		return false;
+
+	loaded.lines.resize(linesCount);
+	loaded.fingerprints.resize(linesCount, NoFingerprint);
+	unsigned int wordsCount = loaded.pool.Count();
+	for (unsigned int i = 0; i < linesCount; i++)
+	{
+		if (lengths[i] > (size_t)(end - data) / sizeof(unsigned int))
+			return false;
+		LineWords &lineWords = loaded.lines[i];
+		lineWords.resize(lengths[i]);
+		if (lengths[i] != 0 && !ReadBytes(data, end, &lineWords[0], lengths[i] * sizeof(unsigned int)))
+			return false;
+		for (unsigned int j = 0; j < lengths[i]; j++)
+		{
+			if (lineWords[j] >= wordsCount)
+				return false;
+		}
+	}
+	if (!loaded.words.Load(data, end))
+		return false;
+
+	Swap(loaded);
+	return true;
+}
+
+vector<wstring> WordIndex::GetWordsLikeThis(const wstring &wordToMatch, int currentLine, int maxCount, Arena &arena) const
+{
+	WordRefLess less;
+	NearbyWords found(less, NearbyWords::allocator_type(arena));
+	for (int distance = 0; distance <= ProximityRadius; distance++)
+	{
+		if (CanStopScanning(distance, (int)found.size(), maxCount))
+			break;
+
+		int above = currentLine - distance;
+		int below = currentLine + distance;
+		if (above < 0 && below >= LinesCount())
+			break;
+		if (above >= 0 && above < LinesCount())
+			FindNearbyWords(pool, lines[above], distance, wordToMatch, found);
+		if (distance > 0 && below >= 0 && below < LinesCount())
+			FindNearbyWords(pool, lines[below], distance, wordToMatch, found);
+	}
+
+	//rank nearby words by how often they occur in the whole file
+	for (NearbyWords::iterator i = found.begin(); i != found.end(); ++i)
+		i->second.count = words.Count(i->first.text, i->first.length);
+
+	vector<wstring> result = RankNearbyWords(found, maxCount);
+	if ((int)result.size() < maxCount)
+	{
+		vector<wstring> frequent;
+		words.FindWordsLikeThis(wordToMatch, maxCount + (int)found.size(), frequent);
+		for (size_t i = 0; i < frequent.size() && (int)result.size() < maxCount; i++)
+		{
+			WordRef word = { frequent[i].c_str(), (int)frequent[i].length() };
+			if (found.find(word) == found.end())
+				result.push_back(frequent[i]);
+		}
+	}
+	return result;
+}
+
+vector<wstring> WordIndex::GetFuzzyWords(const wstring &wordToMatch, int maxCount) const
+{
+	vector<wstring> result;
+	words.FindFuzzyWords(FuzzyPattern(wordToMatch), maxCount, result);
+	return result;
+}
+
+vector<wstring> WordIndex::GetSimilarWords(const wstring &wordToMatch, int maxCount) const
+{
+	vector<wstring> result;
+	words.FindSimilarWords(wordToMatch, maxCount, result);
+	return result;
+}
+
+bool WordIndex::HasSameWords(const LineWords &lineWords, const wchar_t *text, int length, const Delimiters &delimiters) const
+{
+	WordScanner scanner(text, length, delimiters);
+	int wordStart, wordEnd;
+	size_t known = 0;
+	for (; scanner.Next(wordStart, wordEnd); known++)
+	{
+		if (known == lineWords.size()
+			|| pool.Length(lineWords[known]) != wordEnd - wordStart
+			|| wmemcmp(pool.Text(lineWords[known]), text + wordStart, wordEnd - wordStart) != 0)
+		{
+			return false;
+		}
+	}
+	return known == lineWords.size();
+}
+
+void WordIndex::AddWords(const LineWords &lineWords)
+{
+	for (size_t i = 0; i < lineWords.size(); i++)
+		words.Add(pool.Text(lineWords[i]), pool.Length(lineWords[i]));
+}
+
+void WordIndex::RemoveWords(const LineWords &lineWords)
+{
+	for (size_t i = 0; i < lineWords.size(); i++)
+		words.Remove(pool.Text(lineWords[i]), pool.Length(lineWords[i]));
+}
+
+//Interns the words the lines use into the compacted pool and tells the new id
+//of every old one
+void WordIndex::CompactWords(WordPool &compacted, vector<unsigned int> &newIds) const
+{
+	newIds.assign(pool.Count(), WordPool::NoWord);
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		const LineWords &lineWords = lines[i];
+		for (size_t j = 0; j < lineWords.size(); j++)
+		{
+			unsigned int &newId = newIds[lineWords[j]];
+			if (newId == WordPool::NoWord)
+				newId = compacted.Intern(pool.Text(lineWords[j]), pool.Length(lineWords[j]));
+		}
+	}
+}
+
+void WordIndex::CompactPool()
+{
+	WordPool compacted;
+	vector<unsigned int> newIds;
+	CompactWords(compacted, newIds);
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		LineWords &lineWords = lines[i];
+		for (size_t j = 0; j < lineWords.size(); j++)
+			lineWords[j] = newIds[lineWords[j]];
+	}
+	pool.Swap(compacted);
+}
+
+//FNV-1a of the text; two different lines get the same one about once in four
+//billion times, and then the words of the old line stay until it changes again
+unsigned int WordIndex::Fingerprint(const wchar_t *text, int length)
+{
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < length; i++)
+	{
+		hash ^= (unsigned int)text[i];
+		hash *= 16777619u;
+	}
+	return hash != NoFingerprint ? hash : NoFingerprint + 1;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "WordTrie.h"
+#include "WordPool.h"
+#include "Arena.h"
+
+struct Delimiters;
+
+// Vocabulary of a single editor. Remembers which words every line contributed,
+// so a changed line can be replaced without rescanning the rest of the file.
+// Lines keep the ids of their words in the pool, four bytes an occurrence,
+// and a fingerprint of their text, so a line the editor shows again unchanged
+// is recognized without splitting it into words. Words no line uses any more
+// stay in the pool until they are the most of it.
+class WordIndex
+{
+public:
+	void Clear();
+	void Swap(WordIndex &other);
+	int LinesCount() const;
+
+	//Returns false when the line already had the same words
+	bool SetLine(int lineNumber, const wchar_t *text, int length, const Delimiters &delimiters);
+	void InsertLines(int lineNumber, int count);
+	void DeleteLines(int lineNumber, int count);
+
+	void Save(std::vector<unsigned char> &data) const;
+	bool Load(const unsigned char *data, size_t size);
+
+	//The words nearest to the line come first, then the most frequent ones from farther away;
+	//the search keeps its scratch data in the arena
+	std::vector<std::wstring> GetWordsLikeThis(const std::wstring &wordToMatch, int currentLine, int maxCount, Arena &arena) const;
+	std::vector<std::wstring> GetFuzzyWords(const std::wstring &wordToMatch, int maxCount) const;
+	std::vector<std::wstring> GetSimilarWords(const std::wstring &wordToMatch, int maxCount) const;
+
+private:
+	typedef std::vector<unsigned int> LineWords;
+
+	bool HasSameWords(const LineWords &lineWords, const wchar_t *text, int length, const Delimiters &delimiters) const;
+	void AddWords(const LineWords &lineWords);
+	void RemoveWords(const LineWords &lineWords);
+	void CompactWords(WordPool &compacted, std::vector<unsigned int> &newIds) const;
+	void CompactPool();
+	static unsigned int Fingerprint(const wchar_t *text, int length);
+
+	WordPool pool;
+	std::vector<LineWords> lines;
+	//not saved, lines of a snapshot and inserted lines have NoFingerprint
+	std::vector<unsigned int> fingerprints;
+	WordTrie words;
+};
@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "WordPool.h"
+#include "Snapshot.h"
+
+using std::vector;
+
+const size_t MinSlotsCount = 1024;
+
+WordPool::WordPool()
+{
+	Clear();
+}
+
+void WordPool::Clear()
+{
+	chars.clear();
+	starts.assign(1, 0);
+	slots.assign(MinSlotsCount, (unsigned int)NoWord);
+}
+
+void WordPool::Swap(WordPool &other)
+{
+	chars.swap(other.chars);
+	starts.swap(other.starts);
+	slots.swap(other.slots);
+}
+
+unsigned int WordPool::Count() const
+{
+	return (unsigned int)starts.size() - 1;
+}
+
+unsigned int WordPool::Intern(const wchar_t *word, int length)
+{
+	unsigned int &slot = Slot(word, length);
+	if (slot != NoWord)
+		return slot;
+
+	unsigned int id = Count();
+	slot = id;
+	chars.insert(chars.end(), word, word + length);
+	starts.push_back((unsigned int)chars.size());
+	//at most half full, so probes stay short
+	if (Count() * 2 > slots.size())
+		Rehash(slots.size() * 2);
+	return id;
+}
+
+unsigned int WordPool::Find(const wchar_t *word, int length) const
+{
+	return const_cast<WordPool *>(this)->Slot(word, length);
+}
+
+const wchar_t *WordPool::Text(unsigned int id) const
+{
+	return &chars[0] + starts[id];
+}
+
+int WordPool::Length(unsigned int id) const
+{
+	return (int)(starts[id + 1] - starts[id]);
+}
+
+void WordPool::Save(vector<unsigned char> &data) const
+{
+	unsigned int counts[2] = { Count(), (unsigned int)chars.size() };
+	AppendBytes(data, counts, sizeof(counts));
+	AppendBytes(data, &starts[0], starts.size() * sizeof(unsigned int));
+	if (!chars.empty())
+		AppendBytes(data, &chars[0], chars.size() * sizeof(wchar_t));
+}
+
+bool WordPool::Load(const unsigned char *&data, const unsigned char *end)
+{
+	unsigned int counts[2];
+	if (!ReadBytes(data, end, counts, sizeof(counts))
+		|| counts[0] >= (size_t)(end - data) / sizeof(unsigned int)
+		|| counts[1] > (size_t)(end - data) / sizeof(wchar_t))
+	{
+		return false;
+	}
+
+	WordPool loaded;
+	loaded.starts.resize(counts[0] + 1);
+	loaded.chars.resize(counts[1]);
+	if (!ReadBytes(data, end, &loaded.starts[0], loaded.starts.size() * sizeof(unsigned int))
+		|| (counts[1] != 0 && !ReadBytes(data, end, &loaded.chars[0], counts[1] * sizeof(wchar_t))))
+	{
+		return false;
+	}
+
+	//every word must lie within the characters
+	if (loaded.starts[0] != 0 || loaded.starts.back() != counts[1])
+		return false;
+	for (unsigned int id = 0; id < counts[0]; id++)
+	{
+		if (loaded.starts[id] >= loaded.starts[id + 1])
+			return false;
+	}
+	size_t slotsCount = MinSlotsCount;
+	while (slotsCount < (size_t)counts[0] * 2)
+		slotsCount *= 2;
+	if (!loaded.Rehash(slotsCount))
+		return false;
+
+	Swap(loaded);
+	return true;
+}
+
+//FNV-1a
+unsigned int WordPool::Hash(const wchar_t *word, int length)
+{
+	unsigned int hash = 2166136261u;
+	for (int i = 0; i < length; i++)
+	{
+		hash ^= (unsigned int)word[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+unsigned int &WordPool::Slot(const wchar_t *word, int length)
+{
+	size_t mask = slots.size() - 1;
+	for (size_t i = Hash(word, length) & mask;; i = (i + 1) & mask)
+	{
+		unsigned int id = slots[i];
+		if (id == NoWord
+			|| (Length(id) == length && wmemcmp(Text(id), word, length) == 0))
+		{
+			return slots[i];
+		}
+	}
+}
+
+bool WordPool::Rehash(size_t slotsCount)
+{
+	slots.assign(slotsCount, (unsigned int)NoWord);
+	unsigned int count = Count();
+	for (unsigned int id = 0; id < count; id++)
+	{
+		unsigned int &slot = Slot(Text(id), Length(id));
+		if (slot != NoWord)
+			return false;
+		slot = id;
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+// Distinct words under 32-bit ids. The characters of all words are kept back to
+// back in one vector and found again through an open-addressing hash table, so
+// a word costs its characters and three ints however often it occurs. Ids are
+// never reused; a word that is no longer used stays until the pool is rebuilt.
+class WordPool
+{
+public:
+	enum { NoWord = 0xFFFFFFFF };
+
+	WordPool();
+
+	void Clear();
+	void Swap(WordPool &other);
+	unsigned int Count() const;
+
+	unsigned int Intern(const wchar_t *word, int length);
+	unsigned int Find(const wchar_t *word, int length) const;
+	//Valid until the next word is interned
+	const wchar_t *Text(unsigned int id) const;
+	int Length(unsigned int id) const;
+
+	//Only the characters and the starts are stored, the table is rebuilt from them
+	void Save(std::vector<unsigned char> &data) const;
+	bool Load(const unsigned char *&data, const unsigned char *end);
+
+private:
+	static unsigned int Hash(const wchar_t *word, int length);
+	unsigned int &Slot(const wchar_t *word, int length);
+	//False when a word is there twice, which only damaged data can do
+	bool Rehash(size_t slotsCount);
+
+	std::vector<wchar_t> chars;
+	//where every word starts in chars, and where the next one will
+	std::vector<unsigned int> starts;
+	std::vector<unsigned int> slots;
+};
@@ -0,0 +1,578 @@
+#include "stdafx.h"
+#include "WordTrie.h"
+#include "Snapshot.h"
+#include <algorithm>
+
+using std::wstring;
+using std::vector;
+
+const int NoNode = -1;
+const int Root = 0;
+
+WordTrie::WordTrie()
+{
+	Clear();
+}
+
+void WordTrie::Clear()
+{
+	nodes.clear();
+	labels.clear();
+	NewNode(0, 0);
+	wordsCount = 0;
+	deadNodes = 0;
+}
+
+void WordTrie::Swap(WordTrie &other)
+{
+	nodes.swap(other.nodes);
+	labels.swap(other.labels);
+	std::swap(wordsCount, other.wordsCount);
+	std::swap(deadNodes, other.deadNodes);
+}
+
+int WordTrie::WordsCount() const
+{
+	return wordsCount;
+}
+
+int WordTrie::Count(const wchar_t *word, int length) const
+{
+	int node = Root;
+	int pos = 0;
+	while (pos < length)
+	{
+		node = nodes[node].firstChild;
+		while (node != NoNode && labels[nodes[node].labelStart] != word[pos])
+			node = nodes[node].nextSibling;
+		if (node == NoNode || CommonLength(nodes[node], word + pos, length - pos) != nodes[node].labelLength)
+			return 0;
+		pos += nodes[node].labelLength;
+	}
+	return node == Root ? 0 : nodes[node].count;
+}
+
+void WordTrie::Add(const wchar_t *word, int length, int count)
+{
+	if (length <= 0 || count <= 0)
+		return;
+
+	unsigned int chars = FoldedCharsMask(word, length);
+	nodes[Root].charsBelow |= chars;
+	int node = Root;
+	int pos = 0;
+	while (pos < length)
+	{
+		//siblings are kept sorted by the first character of their labels
+		int previous = NoNode;
+		int child = nodes[node].firstChild;
+		while (child != NoNode && labels[nodes[child].labelStart] < word[pos])
+		{
+			previous = child;
+			child = nodes[child].nextSibling;
+		}
+
+		if (child == NoNode || labels[nodes[child].labelStart] != word[pos])
+		{
+			int leaf = NewNode(word + pos, length - pos);
+			nodes[leaf].nextSibling = child;
+			nodes[leaf].parent = node;
+			nodes[leaf].charsBelow = chars;
+			if (previous == NoNode)
+				nodes[node].firstChild = leaf;
+			else
+				nodes[previous].nextSibling = leaf;
+			node = leaf;
+			break;
+		}
+
+		int common = CommonLength(nodes[child], word + pos, length - pos);
+		if (common < nodes[child].labelLength)
+			SplitNode(child, common);
+		nodes[child].charsBelow |= chars;
+		pos += common;
+		node = child;
+	}
+
+	if (nodes[node].count == 0)
+		wordsCount++;
+	nodes[node].count += count;
+
+	for (int n = node; n != NoNode && nodes[n].maxCountBelow < nodes[node].count; n = nodes[n].parent)
+		nodes[n].maxCountBelow = nodes[node].count;
+}
+
+void WordTrie::Remove(const wchar_t *word, int length)
+{
+	int node = Root;
+	int pos = 0;
+	while (pos < length)
+	{
+		node = nodes[node].firstChild;
+		while (node != NoNode && labels[nodes[node].labelStart] != word[pos])
+			node = nodes[node].nextSibling;
+		if (node == NoNode || CommonLength(nodes[node], word + pos, length - pos) != nodes[node].labelLength)
+			return;
+		pos += nodes[node].labelLength;
+	}
+
+	if (node == Root || nodes[node].count == 0)
+		return;
+	if (--nodes[node].count > 0)
+		return;
+	wordsCount--;
+	if (wordsCount == 0)
+	{
+		Clear();
+		return;
+	}
+
+	//unlink the dead leaf and the ancestors it leaves without words or children;
+	//their slots are reclaimed by the next compaction
+	while (node != Root && nodes[node].count == 0 && nodes[node].firstChild == NoNode)
+	{
+		int parent = nodes[node].parent;
+		ReplaceNode(node, NoNode);
+		deadNodes++;
+		node = parent;
+	}
+	//a node left with no word and one child only splits its child's label
+	if (node != Root && nodes[node].count == 0 && nodes[nodes[node].firstChild].nextSibling == NoNode)
+		MergeWithChild(node);
+
+	if (deadNodes > 1024 && deadNodes > (int)nodes.size() / 2)
+		Compact();
+}
+
+void WordTrie::FindWordsLikeThis(const wstring &prefix, int maxCount, vector<wstring> &result) const
+{
+	if (maxCount <= 0)
+		return;
+
+	const wchar_t *text = prefix.c_str();
+	int length = (int)prefix.length();
+	int wordLength = length;
+	int node = Root;
+	int pos = 0;
+	while (pos < length)
+	{
+		node = nodes[node].firstChild;
+		while (node != NoNode && labels[nodes[node].labelStart] != text[pos])
+			node = nodes[node].nextSibling;
+		if (node == NoNode)
+			return;
+
+		int common = CommonLength(nodes[node], text + pos, length - pos);
+		if (common < nodes[node].labelLength)
+		{
+			if (pos + common < length)
+				return;
+			//the prefix ends in the middle of this label
+			wordLength += nodes[node].labelLength - common;
+		}
+		pos += common;
+	}
+
+	//the heap keeps the weakest of the best candidates on top, so a short prefix
+	//matching thousands of words never sorts more than maxCount of them
+	vector<Candidate> best;
+	best.reserve(maxCount);
+	int order = 0;
+	SelectBest(node, wordLength, length, 0, maxCount, order, best);
+	SpellOutBest(best, result);
+}
+
+void WordTrie::FindFuzzyWords(const FuzzyPattern &pattern, int maxCount, vector<wstring> &result) const
+{
+	if (maxCount <= 0 || !pattern.IsValid())
+		return;
+
+	vector<Candidate> best;
+	best.reserve(maxCount);
+	int order = 0;
+	SelectFuzzy(Root, pattern.Start(), pattern, maxCount, order, best);
+	SpellOutBest(best, result);
+}
+
+void WordTrie::FindSimilarWords(const wstring &prefix, int maxCount, vector<wstring> &result) const
+{
+	SimilarSearch search;
+	search.prefix = prefix.c_str();
+	search.prefixLength = (int)prefix.length();
+	search.maxDistance = MaxTypos(search.prefixLength);
+	search.maxCount = maxCount;
+	search.order = 0;
+	if (maxCount <= 0 || search.maxDistance == 0)
+		return;
+	search.best.reserve(maxCount);
+
+	//the walk simulates a Levenshtein automaton of the prefix: a subtree is
+	//abandoned as soon as no path through it can stay within the typo limit
+	DistanceRow row;
+	for (int i = 0; i <= search.prefixLength; i++)
+	{
+		row.cells[i] = (unsigned char)std::min(i, search.maxDistance + 1);
+		row.before[i] = (unsigned char)(search.maxDistance + 1);
+	}
+	row.lastChar = 0;
+	row.minimum = 0;
+	SelectSimilar(Root, row, row.cells[search.prefixLength], 0, search);
+	SpellOutBest(search.best, result);
+}
+
+int WordTrie::MaxTypos(int prefixLength)
+{
+	if (prefixLength < 3 || prefixLength > MaxSimilarPrefix)
+		return 0;
+	return prefixLength < 6 ? 1 : 2;
+}
+
+int WordTrie::NewNode(const wchar_t *label, int length)
+{
+	Node node;
+	node.labelStart = (int)labels.size();
+	node.labelLength = length;
+	node.firstChild = NoNode;
+	node.nextSibling = NoNode;
+	node.parent = NoNode;
+	node.count = 0;
+	node.maxCountBelow = 0;
+	node.charsBelow = 0;
+	labels.insert(labels.end(), label, label + length);
+	nodes.push_back(node);
+	return (int)nodes.size() - 1;
+}
+
+void WordTrie::SplitNode(int node, int length)
+{
+	Node tail = nodes[node];
+	tail.labelStart += length;
+	tail.labelLength -= length;
+	tail.nextSibling = NoNode;
+	tail.parent = node;
+	nodes.push_back(tail);
+	int tailNode = (int)nodes.size() - 1;
+	for (int child = tail.firstChild; child != NoNode; child = nodes[child].nextSibling)
+		nodes[child].parent = tailNode;
+
+	Node &head = nodes[node];
+	head.labelLength = length;
+	head.firstChild = tailNode;
+	head.count = 0;
+}
+
+//the child takes the node's place with the node's label in front of its own
+void WordTrie::MergeWithChild(int node)
+{
+	int child = nodes[node].firstChild;
+	if (nodes[node].labelStart + nodes[node].labelLength == nodes[child].labelStart)
+		nodes[child].labelStart = nodes[node].labelStart;
+	else
+	{
+		//split from different words, so the joined label is copied to the end of the pool
+		wstring label(&labels[0] + nodes[node].labelStart, nodes[node].labelLength);
+		label.append(&labels[0] + nodes[child].labelStart, nodes[child].labelLength);
+		nodes[child].labelStart = (int)labels.size();
+		labels.insert(labels.end(), label.begin(), label.end());
+	}
+	nodes[child].labelLength += nodes[node].labelLength;
+	ReplaceNode(node, child);
+	deadNodes++;
+}
+
+//the replacement keeps the node's place among its siblings, NoNode just unlinks it
+void WordTrie::ReplaceNode(int node, int replacement)
+{
+	int parent = nodes[node].parent;
+	int next = nodes[node].nextSibling;
+	if (replacement == NoNode)
+		replacement = next;
+	else
+	{
+		nodes[replacement].parent = parent;
+		nodes[replacement].nextSibling = next;
+	}
+
+	if (nodes[parent].firstChild == node)
+		nodes[parent].firstChild = replacement;
+	else
+	{
+		int previous = nodes[parent].firstChild;
+		while (nodes[previous].nextSibling != node)
+			previous = nodes[previous].nextSibling;
+		nodes[previous].nextSibling = replacement;
+	}
+}
+
+int WordTrie::CommonLength(const Node &node, const wchar_t *word, int length) const
+{
+	int common = 0;
+	int maxLength = node.labelLength < length ? node.labelLength : length;
+	const wchar_t *label = &labels[0] + node.labelStart;
+	while (common < maxLength && label[common] == word[common])
+		common++;
+	return common;
+}
+
+void WordTrie::SelectBest(int node, int length, int minLength, int tier, int maxCount, int &order, vector<Candidate> &best) const
+{
+	if (nodes[node].count > 0 && length > minLength)
+	{
+		Candidate candidate;
+		candidate.tier = tier;
+		candidate.count = nodes[node].count;
+		candidate.order = order++;
+		candidate.node = node;
+		Offer(candidate, maxCount, best);
+	}
+
+	for (int child = nodes[node].firstChild; child != NoNode; child = nodes[child].nextSibling)
+	{
+		if (CanImprove(child, tier, maxCount, best))
+			SelectBest(child, length + nodes[child].labelLength, minLength, tier, maxCount, order, best);
+	}
+}
+
+void WordTrie::SelectFuzzy(int node, FuzzyPattern::State state, const FuzzyPattern &pattern, int maxCount, int &order, vector<Candidate> &best) const
+{
+	for (int i = 0; i < nodes[node].labelLength; i++)
+		pattern.Step(state, labels[nodes[node].labelStart + i]);
+
+	if (nodes[node].count > 0 && state.length > pattern.Length())
+	{
+		Candidate candidate;
+		candidate.tier = pattern.Tier(state);
+		candidate.count = nodes[node].count;
+		candidate.order = order++;
+		candidate.node = node;
+		if (candidate.tier >= 0)
+			Offer(candidate, maxCount, best);
+	}
+
+	//skip the subtrees that lack some of the characters still to be matched
+	unsigned int missing = pattern.MissingChars(state);
+	for (int child = nodes[node].firstChild; child != NoNode; child = nodes[child].nextSibling)
+	{
+		if ((missing & ~nodes[child].charsBelow) == 0 && CanImprove(child, 0, maxCount, best))
+			SelectFuzzy(child, state, pattern, maxCount, order, best);
+	}
+}
+
+void WordTrie::SelectSimilar(int node, DistanceRow row, int distance, int length, SimilarSearch &search) const
+{
+	for (int i = 0; i < nodes[node].labelLength; i++)
+	{
+		NextRow(row, labels[nodes[node].labelStart + i], search);
+		distance = std::min(distance, (int)row.cells[search.prefixLength]);
+		if (distance > search.maxDistance && row.minimum > search.maxDistance)
+			return;
+	}
+	length += nodes[node].labelLength;
+
+	if (nodes[node].count > 0 && distance <= search.maxDistance && (distance > 0 || length > search.prefixLength))
+	{
+		Candidate candidate;
+		candidate.tier = distance;
+		candidate.count = nodes[node].count;
+		candidate.order = search.order++;
+		candidate.node = node;
+		Offer(candidate, search.maxCount, search.best);
+	}
+
+	//the words below can't get any closer, so they only compete by frequency
+	int minLength = distance > 0 ? 0 : search.prefixLength;
+	bool closerBelow = row.minimum < distance;
+	int lowestTier = std::min(distance, row.minimum);
+	for (int child = nodes[node].firstChild; child != NoNode; child = nodes[child].nextSibling)
+	{
+		if (!CanImprove(child, lowestTier, search.maxCount, search.best))
+			continue;
+		if (closerBelow)
+			SelectSimilar(child, row, distance, length, search);
+		else
+			SelectBest(child, length + nodes[child].labelLength, minLength, distance, search.maxCount, search.order, search.best);
+	}
+}
+
+void WordTrie::NextRow(DistanceRow &row, wchar_t ch, const SimilarSearch &search) const
+{
+	int limit = search.maxDistance + 1;
+	unsigned char previous[MaxSimilarPrefix + 1];
+	std::copy(row.cells, row.cells + search.prefixLength + 1, previous);
+
+	row.cells[0] = (unsigned char)std::min(previous[0] + 1, limit);
+	row.minimum = row.cells[0];
+	for (int i = 1; i <= search.prefixLength; i++)
+	{
+		int cost = previous[i - 1] + (search.prefix[i - 1] == ch ? 0 : 1);
+		cost = std::min(cost, previous[i] + 1);
+		cost = std::min(cost, row.cells[i - 1] + 1);
+		if (i > 1 && search.prefix[i - 1] == row.lastChar && search.prefix[i - 2] == ch)
+			cost = std::min(cost, row.before[i - 2] + 1);
+		row.cells[i] = (unsigned char)std::min(cost, limit);
+		row.minimum = std::min(row.minimum, (int)row.cells[i]);
+	}
+
+	std::copy(previous, previous + search.prefixLength + 1, row.before);
+	row.lastChar = ch;
+}
+
+bool WordTrie::CanImprove(int node, int tier, int maxCount, const vector<Candidate> &best) const
+{
+	if ((int)best.size() < maxCount)
+		return true;
+	//words visited later lose ties, so they have to be strictly better
+	const Candidate &weakest = best.front();
+	return tier < weakest.tier || (tier == weakest.tier && nodes[node].maxCountBelow > weakest.count);
+}
+
+void WordTrie::SpellOutBest(vector<Candidate> &best, vector<wstring> &result) const
+{
+	//only the winners get spelled out, right where the result keeps them
+	std::sort_heap(best.begin(), best.end(), IsStronger);
+	result.reserve(result.size() + best.size());
+	for (size_t i = 0; i < best.size(); i++)
+	{
+		result.push_back(wstring());
+		SpellOut(best[i].node, result.back());
+	}
+}
+
+void WordTrie::SpellOut(int node, wstring &word) const
+{
+	int length = 0;
+	for (int n = node; n != Root; n = nodes[n].parent)
+		length += nodes[n].labelLength;
+
+	word.assign(length, L' ');
+	for (int n = node; n != Root; n = nodes[n].parent)
+	{
+		length -= nodes[n].labelLength;
+		std::copy(labels.begin() + nodes[n].labelStart,
+			labels.begin() + nodes[n].labelStart + nodes[n].labelLength,
+			word.begin() + length);
+	}
+}
+
+void WordTrie::CopyTo(int node, wstring &word, WordTrie &target) const
+{
+	if (nodes[node].count > 0)
+		target.Add(word.c_str(), (int)word.length(), nodes[node].count);
+
+	for (int child = nodes[node].firstChild; child != NoNode; child = nodes[child].nextSibling)
+	{
+		size_t length = word.length();
+		word.append(&labels[0] + nodes[child].labelStart, nodes[child].labelLength);
+		CopyTo(child, word, target);
+		word.resize(length);
+	}
+}
+
+void WordTrie::Compact()
+{
+	WordTrie compacted;
+	wstring word;
+	CopyTo(Root, word, compacted);
+
+	Swap(compacted);
+}
+
+void WordTrie::Save(vector<unsigned char> &data) const
+{
+	unsigned int counts[4] = { (unsigned int)nodes.size(), (unsigned int)labels.size(), (unsigned int)wordsCount, (unsigned int)deadNodes };
+	AppendBytes(data, counts, sizeof(counts));
+	AppendBytes(data, &nodes[0], nodes.size() * sizeof(Node));
+	if (!labels.empty())
+		AppendBytes(data, &labels[0], labels.size() * sizeof(wchar_t));
+}
+
+bool WordTrie::Load(const unsigned char *&data, const unsigned char *end)
+{
+	unsigned int counts[4];
+	if (!ReadBytes(data, end, counts, sizeof(counts)) || counts[0] == 0
+		|| counts[0] > (size_t)(end - data) / sizeof(Node)
+		|| counts[1] > (size_t)(end - data) / sizeof(wchar_t))
+	{
+		return false;
+	}
+
+	WordTrie loaded;
+	loaded.nodes.resize(counts[0]);
+	loaded.labels.resize(counts[1]);
+	loaded.wordsCount = counts[2];
+	loaded.deadNodes = counts[3];
+	if (!ReadBytes(data, end, &loaded.nodes[0], counts[0] * sizeof(Node))
+		|| (counts[1] != 0 && !ReadBytes(data, end, &loaded.labels[0], counts[1] * sizeof(wchar_t))))
+	{
+		return false;
+	}
+
+	//a snapshot that passed its checksum but points outside itself would crash the searches
+	for (size_t i = 0; i < loaded.nodes.size(); i++)
+	{
+		const Node &node = loaded.nodes[i];
+		if (node.labelStart < 0 || node.labelStart > (int)counts[1]
+			|| node.labelLength < 0 || node.labelLength > (int)counts[1] - node.labelStart
+			|| node.firstChild < NoNode || node.firstChild >= (int)counts[0]
+			|| node.nextSibling < NoNode || node.nextSibling >= (int)counts[0]
+			|| node.parent < NoNode || node.parent >= (int)counts[0])
+		{
+			return false;
+		}
+	}
+	if (!loaded.IsTree())
+		return false;
+
+	Swap(loaded);
+	return true;
+}
+
+//every node below the root is reached once, from the parent it names, and has a
+//label to be told apart by; a cycle would keep the searches going forever
+bool WordTrie::IsTree() const
+{
+	if (nodes[Root].parent != NoNode)
+		return false;
+
+	vector<bool> reached(nodes.size(), false);
+	reached[Root] = true;
+	vector<int> pending(1, Root);
+	while (!pending.empty())
+	{
+		int node = pending.back();
+		pending.pop_back();
+		for (int child = nodes[node].firstChild; child != NoNode; child = nodes[child].nextSibling)
+		{
+			if (reached[child] || nodes[child].parent != node || nodes[child].labelLength == 0)
+				return false;
+			reached[child] = true;
+			pending.push_back(child);
+		}
+	}
+	return true;
+}
+
+void WordTrie::Offer(const Candidate &candidate, int maxCount, vector<Candidate> &best)
+{
+	if ((int)best.size() < maxCount)
+	{
+		best.push_back(candidate);
+		std::push_heap(best.begin(), best.end(), IsStronger);
+	}
+	else if (IsStronger(candidate, best.front()))
+	{
+		std::pop_heap(best.begin(), best.end(), IsStronger);
+		best.back() = candidate;
+		std::push_heap(best.begin(), best.end(), IsStronger);
+	}
+}
+
+bool WordTrie::IsStronger(const Candidate &a, const Candidate &b)
+{
+	if (a.tier != b.tier)
+		return a.tier < b.tier;
+	if (a.count != b.count)
+		return a.count > b.count;
+	//the walk goes in alphabetical order
+	return a.order < b.order;
+}
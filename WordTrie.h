@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Fuzzy.h"
+
+// Path-compressed radix trie of words with occurrence counts. Nodes live in one
+// vector and edge labels in one character pool, so a word costs a few ints
+// plus the characters it doesn't share with other words.
+class WordTrie
+{
+public:
+	WordTrie();
+
+	void Clear();
+	void Swap(WordTrie &other);
+	int WordsCount() const;
+	int Count(const wchar_t *word, int length) const;
+
+	void Add(const wchar_t *word, int length, int count = 1);
+	void Remove(const wchar_t *word, int length);
+
+	//Nodes and labels refer to each other by indexes only, so they are stored as they are
+	void Save(std::vector<unsigned char> &data) const;
+	bool Load(const unsigned char *&data, const unsigned char *end);
+
+	//Appends up to maxCount words that start with the prefix and are longer than it,
+	//the most frequent first and alphabetically among equals
+	void FindWordsLikeThis(const std::wstring &prefix, int maxCount, std::vector<std::wstring> &result) const;
+
+	//Same for the words the pattern matches, abbreviations ranked before other subsequences
+	void FindFuzzyWords(const FuzzyPattern &pattern, int maxCount, std::vector<std::wstring> &result) const;
+
+	//Same for the words that begin within a typo or two of the prefix, the closest first
+	void FindSimilarWords(const std::wstring &prefix, int maxCount, std::vector<std::wstring> &result) const;
+	static int MaxTypos(int prefixLength);
+
+	enum { MaxSimilarPrefix = 32 };
+
+private:
+	struct Node
+	{
+		int labelStart;
+		int labelLength;
+		int firstChild;
+		int nextSibling;
+		int parent;
+		int count;
+		//upper bounds for the words below, loose after removals until compaction
+		int maxCountBelow;
+		unsigned int charsBelow;
+	};
+
+	struct Candidate
+	{
+		int tier;
+		int count;
+		int order;
+		int node;
+	};
+
+	//edit distances between the prefix and the path so far, capped above the limit;
+	//the row before and the last character let swapped neighbours count as one typo
+	struct DistanceRow
+	{
+		unsigned char cells[MaxSimilarPrefix + 1];
+		unsigned char before[MaxSimilarPrefix + 1];
+		wchar_t lastChar;
+		int minimum;
+	};
+
+	struct SimilarSearch
+	{
+		const wchar_t *prefix;
+		int prefixLength;
+		int maxDistance;
+		int maxCount;
+		int order;
+		std::vector<Candidate> best;
+	};
+
+	int NewNode(const wchar_t *label, int length);
+	void SplitNode(int node, int length);
+	void MergeWithChild(int node);
+	void ReplaceNode(int node, int replacement);
+	int CommonLength(const Node &node, const wchar_t *word, int length) const;
+	void SelectBest(int node, int length, int minLength, int tier, int maxCount, int &order, std::vector<Candidate> &best) const;
+	void SelectFuzzy(int node, FuzzyPattern::State state, const FuzzyPattern &pattern, int maxCount, int &order, std::vector<Candidate> &best) const;
+	void SelectSimilar(int node, DistanceRow row, int distance, int length, SimilarSearch &search) const;
+	void NextRow(DistanceRow &row, wchar_t ch, const SimilarSearch &search) const;
+	bool CanImprove(int node, int tier, int maxCount, const std::vector<Candidate> &best) const;
+	void SpellOutBest(std::vector<Candidate> &best, std::vector<std::wstring> &result) const;
+	void SpellOut(int node, std::wstring &word) const;
+	void CopyTo(int node, std::wstring &word, WordTrie &target) const;
+	void Compact();
+	bool IsTree() const;
+
+	static void Offer(const Candidate &candidate, int maxCount, std::vector<Candidate> &best);
+	static bool IsStronger(const Candidate &a, const Candidate &b);
+
+	std::vector<Node> nodes;
+	std::vector<wchar_t> labels;
+	int wordsCount;
+	int deadNodes;
+};
@@ -1,71 +1,249 @@
 #include "stdafx.h"
 #include "WordsComplete.h"
 #include "plugin.hpp"
+#include "farkeys.hpp"
+#include "farcolor.hpp"
+#include "EditorHost.h"
+#include "Completion.h"
+#include "Indexer.h"
+#include "Tokenizer.h"
+#include "Dictionary.h"
+#include "Snapshot.h"
+#include "ProjectIndex.h"
+#include "Settings.h"
+#include "Timings.h"
+#include "PopupTimer.h"
+#include "ParallelScan.h"
 #include <string>
-#include <locale>
 #include <vector>
-#include <set>
+#include <map>
 #include <algorithm>
 
 using std::wstring;
 using std::vector;
-using std::set;
+using std::map;
 
 #define PROCESS_EVENT 0
 #define IGNORE_EVENT  1
 
+// The editor FAR has in focus.
+class FarEditorHost : public EditorHost
+{
+public:
+	virtual void GetInfo(EditorInfo &editorInfo);
+	virtual EditorGetString GetLine(int lineNumber);
+	virtual wstring GetFileName();
+	virtual void SetPosition(const EditorSetPosition &position);
+	virtual void InsertText(const wchar_t *text);
+	virtual void DeleteChar();
+	virtual void UndoRedo(int command);
+	virtual void Redraw();
+	virtual void AddColor(const EditorColor &color);
+	virtual int Menu(MenuItems &items, int x, int y);
+	virtual int PopupMenu(MenuItems &items, int x, int y, wchar_t &typed);
+
+private:
+	int ShowMenu(MenuItems &items, int x, int y, bool typing, wchar_t &typed);
+};
+
+// What the dialog of a menu keeps between its messages.
+struct MenuDialog
+{
+	MenuItems *items;
+	//the list box gets a page more whenever its last item is reached
+	int itemsShown;
+	//the popup closes on a typed character and hands it over
+	bool typing;
+	wchar_t typed;
+};
+
 bool IsItHotkey(INPUT_RECORD *rec);
-wstring GetCurrentWord(int position);
-bool IsDelimiter(wchar_t ch);
-bool IsNotDelimiter(wchar_t ch);
-vector<wstring> Split(wstring line);
-vector<wstring> GatherWordsLikeThis(wstring word, int currentLine, int linesCount);
-int ShowMenu(vector<wstring> items, int line, int position);
-void WriteWord(wstring word);
+bool IsItFuzzyHotkey(INPUT_RECORD *rec);
+bool IsItTyping(INPUT_RECORD *rec, const Delimiters &delimiters);
+bool IsItTab(INPUT_RECORD *rec);
+void WatchTyping(INPUT_RECORD *rec);
+bool WatchGhostText(INPUT_RECORD *rec);
+void HideEditorGhostText(int editorId);
+void OnPopupDue();
+void ShowPopupWords();
+void ShowGhostWord();
+bool IsEditorInFocus();
+int GhostColor();
+LONG_PTR WINAPI MenuDialogProc(HANDLE dialog, int message, int param1, LONG_PTR param2);
+void AddMenuPage(HANDLE dialog, MenuDialog &menu);
+wchar_t TypedChar(int key);
+EditorState &GetEditorState(const EditorInfo &editorInfo);
+wstring GetWordDividers(const wstring &fileName);
+void OnIndexJobDone(IndexJob *job);
 
 const wchar_t *PluginName = L"Words Complete";
+const wchar_t *ProjectWordsOption = L"Complete from other files of the project";
+const wchar_t *AutoPopupOption = L"Show words while typing";
+const wchar_t *GhostTextOption = L"Show the rest of the best word after the cursor";
+const wchar_t *MeasureTimingsOption = L"Measure how long completion takes";
+const wchar_t *ScanTimeOption = L"Time to search the file before it is indexed: %d ms";
+const wchar_t *ScanTimePrompt = L"Milliseconds to search the file before it is indexed";
+const wchar_t *ShowTimingsCommand = L"Show completion timings";
+const wchar_t *SaveTimingsCommand = L"Save completion timings";
+const wchar_t *ResetTimingsCommand = L"Reset completion timings";
+
+//longest word dividers the editor hands out
+const int MaxWordDividers = 256;
 
 static PluginStartupInfo Info;
+static wstring PluginFolder;
+static FarEditorHost Host;
+static map<int, EditorState> Editors;
+//passed with ACTL_SYNCHRO when the popup is due, to tell it from finished index jobs
+static int PopupSynchro;
+//passed with ACTL_SYNCHRO once the editor has the key typed before the ghost text
+static int GhostSynchro;
 
 void WORDSCOMPLETE_API SetStartupInfoW(struct PluginStartupInfo *info)
 {
 	Info = *info;
+	LoadSettings(Info.RootKey);
+	wstring modulePath = Info.ModuleName;
+	PluginFolder = modulePath.substr(0, modulePath.find_last_of(L'\\') + 1);
+	SetDictionariesFolder(PluginFolder + L"Dictionaries\\");
+	SetSnapshotsFolder(PluginFolder + L"Cache\\");
+	EnableTimings(Options.measureTimings);
+	InitTokenizer();
+	StartIndexer(OnIndexJobDone);
+	StartScanThreads(DefaultScanThreads());
+	if (Options.autoPopup)
+		StartPopupTimer(OnPopupDue);
+}
+
+void WORDSCOMPLETE_API ExitFARW()
+{
+	StopPopupTimer();
+	StopScanThreads();
+	StopIndexer();
+	CloseProjectIndexes();
+	CloseDictionaries();
 }
 
 int WORDSCOMPLETE_API ProcessEditorInputW(INPUT_RECORD *rec)
 {
-	if (!IsItHotkey(rec))
+	if (Options.ghostText && WatchGhostText(rec))
+		return IGNORE_EVENT;
+	if (Options.autoPopup)
+		WatchTyping(rec);
+
+	bool fuzzy = IsItFuzzyHotkey(rec);
+	if (!fuzzy && !IsItHotkey(rec))
 		return PROCESS_EVENT;
 	
 	EditorInfo editorInfo;
 	Info.EditorControl(ECTL_GETINFO, &editorInfo);
+	EditorState &state = GetEditorState(editorInfo);
+	return CompleteWord(Host, editorInfo, state, fuzzy) ? IGNORE_EVENT : PROCESS_EVENT;
+}
 
-	if (editorInfo.CurPos == 0)
-		return PROCESS_EVENT;
+int WORDSCOMPLETE_API ProcessEditorEventW(int event, void *param)
+{
+	switch (event)
+	{
+	case EE_READ:
+	case EE_REDRAW:
+		{
+			EditorInfo editorInfo;
+			Info.EditorControl(ECTL_GETINFO, &editorInfo);
+			if (event == EE_READ)
+			{
+				EditorState &state = Editors[editorInfo.EditorID];
+				SetWordDividers(Host, editorInfo, state, GetWordDividers(Host.GetFileName()));
+				OpenIndex(Host, editorInfo, state);
+			}
+			else
+			{
+				//the words of the ghost text aren't the file's
+				EditorState &state = GetEditorState(editorInfo);
+				StampSavedFile(editorInfo, state);
+				if (state.ghost.text.empty())
+					UpdateIndex(Host, editorInfo, state, param == EEREDRAW_LINE);
+			}
+		}
+		break;
 
-	wstring wordToMatch = GetCurrentWord(editorInfo.CurPos);
-	vector<wstring> words = GatherWordsLikeThis(wordToMatch, editorInfo.CurLine, editorInfo.TotalLines);
+	case EE_SAVE:
+		{
+			EditorInfo editorInfo;
+			Info.EditorControl(ECTL_GETINFO, &editorInfo);
+			EditorState &state = GetEditorState(editorInfo);
+			//written by a macro or another plugin while the ghost text is shown
+			if (!state.ghost.text.empty())
+			{
+				HideGhostText(Host, state);
+				Info.EditorControl(ECTL_GETINFO, &editorInfo);
+			}
+			//saved under another extension
+			SetWordDividers(Host, editorInfo, state, GetWordDividers(Host.GetFileName()));
+			IndexSavedFile(Host, editorInfo, state);
+		}
+		break;
 
-	if (words.empty())
-		return PROCESS_EVENT;
+	case EE_GOTFOCUS:
+		{
+			//FAR doesn't tell when the word dividers change, so they are
+			//looked at again whenever the editor is switched to
+			EditorInfo editorInfo;
+			Info.EditorControl(ECTL_GETINFO, &editorInfo);
+			EditorState &state = GetEditorState(editorInfo);
+			SetWordDividers(Host, editorInfo, state, GetWordDividers(state.fileName));
+		}
+		break;
 
-	int choice;
-	if (words.size() > 1)
-	{
-		int x = editorInfo.CurPos - editorInfo.LeftPos;
-		int y = editorInfo.CurLine - editorInfo.TopScreenLine;
-		choice = ShowMenu(words, x, y);
-	}
-	else
-		choice = 0;
+	case EE_KILLFOCUS:
+		HideEditorGhostText(*(int *)param);
+		break;
 
-	if (choice < 0)
-		return PROCESS_EVENT;
+	case EE_CLOSE:
+		{
+			int editorId = *(int *)param;
+			CancelIndexJobs(editorId);
+			CancelPopupTimer();
+			HideEditorGhostText(editorId);
+			map<int, EditorState>::iterator i = Editors.find(editorId);
+			if (i != Editors.end())
+			{
+				SaveIndex(i->second);
+				Editors.erase(i);
+			}
+		}
+		break;
+	}
+	return 0;
+}
 
-	wstring chosenWord = words[choice];
-	WriteWord(chosenWord.substr(wordToMatch.length(), chosenWord.length() - wordToMatch.length()));
+int WORDSCOMPLETE_API ProcessSynchroEventW(int event, void *param)
+{
+	if (event != SE_COMMONSYNCHRO)
+		return 0;
+	if (param == &PopupSynchro)
+	{
+		ShowPopupWords();
+		return 0;
+	}
+	if (param == &GhostSynchro)
+	{
+		ShowGhostWord();
+		return 0;
+	}
 
-	return IGNORE_EVENT;
+	IndexJob *job = (IndexJob *)param;
+	map<int, EditorState>::iterator i = Editors.find(job->editorId);
+	if (i != Editors.end() && InstallIndex(i->second, *job))
+	{
+		//catch up with the edits made while the snapshot was being indexed,
+		//or index the lines after all if the cached index turned out to be unusable
+		EditorInfo editorInfo;
+		if (Info.EditorControl(ECTL_GETINFO, &editorInfo) && editorInfo.EditorID == job->editorId)
+			UpdateIndex(Host, editorInfo, i->second, false);
+	}
+	delete job;
+	return 0;
 }
 
 void   WINAPI _export GetPluginInfoW(struct PluginInfo *Info)
@@ -73,62 +251,459 @@ void   WINAPI _export GetPluginInfoW(struct PluginInfo *Info)
 	Info->StructSize = sizeof(*Info);
 	Info->Flags = PF_EDITOR | PF_DISABLEPANELS;
 	Info->DiskMenuStringsNumber = 0;
-	Info->PluginConfigStringsNumber = 0;
+	Info->PluginConfigStrings = &PluginName;
+	Info->PluginConfigStringsNumber = 1;
 	Info->PluginMenuStrings = &PluginName;
-	Info->PluginMenuStringsNumber = 0;
+	Info->PluginMenuStringsNumber = 1;
 }
 
-int ShowMenu(vector<wstring> items, int x, int y)
+HANDLE WORDSCOMPLETE_API OpenPluginW(int openFrom, INT_PTR item)
 {
-	const int MaxMenuSize = 20;
-	FarMenuItem menu[MaxMenuSize];
-	int menuSize = items.size() > MaxMenuSize ? MaxMenuSize : items.size();
-	for (int i = 0; i < menuSize; i++)
+	FarMenuItem menu[3];
+	const wchar_t *commands[3] = { ShowTimingsCommand, SaveTimingsCommand, ResetTimingsCommand };
+	for (int i = 0; i < 3; i++)
 	{
 		menu[i].Checked = 0;
 		menu[i].Selected = 0;
 		menu[i].Separator = 0;
-		menu[i].Text = items[i].c_str();
+		menu[i].Text = commands[i];
+	}
+
+	int choice = Info.Menu(Info.ModuleNumber, -1, -1, 0, FMENU_WRAPMODE, PluginName, 0, 0, 0, 0, menu, 3);
+	if (choice == 0)
+	{
+		//the viewer deletes the file when it is closed
+		wchar_t tempFolder[MAX_PATH];
+		DWORD length = GetTempPathW(MAX_PATH, tempFolder);
+		wstring fileName = wstring(tempFolder, length < MAX_PATH ? length : 0) + L"WordsComplete timings.txt";
+		if (SaveTimings(fileName))
+			Info.Viewer(fileName.c_str(), ShowTimingsCommand, 0, 0, -1, -1, VF_DELETEONCLOSE, CP_UTF8);
+	}
+	else if (choice == 1)
+	{
+		wstring fileName = PluginFolder + L"Timings.txt";
+		const wchar_t *message[2] = { PluginName, NULL };
+		wstring text = SaveTimings(fileName) ? L"Saved to " + fileName : L"Can't write " + fileName;
+		message[1] = text.c_str();
+		Info.Message(Info.ModuleNumber, FMSG_MB_OK, NULL, message, 2, 0);
 	}
+	else if (choice == 2)
+		ResetTimings();
 
-	return Info.Menu(Info.ModuleNumber, x + 2, y + 2, MaxMenuSize + 2, 
-		FMENU_WRAPMODE, 0, 0, 0, 0, 0, menu, menuSize);
+	return INVALID_HANDLE_VALUE;
 }
 
-void WriteWord(wstring word)
+int WORDSCOMPLETE_API ConfigureW(int itemNumber)
 {
-	Info.EditorControl(ECTL_INSERTTEXT, (void *)word.c_str());
-	Info.EditorControl(ECTL_REDRAW, 0);
+	//every pick flips or asks for the option, Esc closes the menu
+	int choice = 0;
+	for (;;)
+	{
+		wchar_t scanTime[100];
+		_snwprintf(scanTime, sizeof(scanTime) / sizeof(scanTime[0]), ScanTimeOption, Options.scanMilliseconds);
+		FarMenuItem menu[5];
+		menu[0].Checked = Options.projectWords;
+		menu[0].Text = ProjectWordsOption;
+		menu[1].Checked = Options.autoPopup;
+		menu[1].Text = AutoPopupOption;
+		menu[2].Checked = Options.ghostText;
+		menu[2].Text = GhostTextOption;
+		menu[3].Checked = Options.measureTimings;
+		menu[3].Text = MeasureTimingsOption;
+		menu[4].Checked = 0;
+		menu[4].Text = scanTime;
+		for (int i = 0; i < 5; i++)
+		{
+			menu[i].Selected = i == choice;
+			menu[i].Separator = 0;
+		}
+		choice = Info.Menu(Info.ModuleNumber, -1, -1, 0, FMENU_WRAPMODE, PluginName, 0, 0, 0, 0, menu, 5);
+		if (choice < 0)
+			return TRUE;
+
+		if (choice == 0)
+		{
+			Options.projectWords = !Options.projectWords;
+			if (!Options.projectWords)
+				CloseProjectIndexes();
+		}
+		else if (choice == 1)
+		{
+			Options.autoPopup = !Options.autoPopup;
+			if (Options.autoPopup)
+				StartPopupTimer(OnPopupDue);
+			else
+				StopPopupTimer();
+		}
+		else if (choice == 2)
+			Options.ghostText = !Options.ghostText;
+		else if (choice == 3)
+		{
+			Options.measureTimings = !Options.measureTimings;
+			EnableTimings(Options.measureTimings);
+		}
+		else
+		{
+			wchar_t current[20], entered[20];
+			_snwprintf(current, sizeof(current) / sizeof(current[0]), L"%d", Options.scanMilliseconds);
+			if (!Info.InputBox(PluginName, ScanTimePrompt, NULL, current, entered, sizeof(entered) / sizeof(entered[0]), NULL, 0))
+				continue;
+			int milliseconds = _wtoi(entered);
+			if (milliseconds <= 0)
+				continue;
+			Options.scanMilliseconds = std::min(milliseconds, MaxScanMilliseconds);
+		}
+		SaveSettings();
+	}
 }
 
-vector<wstring> GatherWordsLikeThis(wstring wordToMatch, int currentLine, int linesCount)
+void FarEditorHost::GetInfo(EditorInfo &editorInfo)
 {
-	set<wstring> result;
-	const int ScanRadius = 2000;
-	int firstLineToScan = currentLine > ScanRadius 
-							? currentLine - ScanRadius 
-							: 0;
-	int lastLineToScan = linesCount > currentLine + ScanRadius 
-							? currentLine + ScanRadius 
-							: linesCount;
+	Info.EditorControl(ECTL_GETINFO, &editorInfo);
+}
 
+EditorGetString FarEditorHost::GetLine(int lineNumber)
+{
 	EditorGetString getStringInfo;
-	for (int lineNumber = firstLineToScan; lineNumber < lastLineToScan; lineNumber++)
+	getStringInfo.StringNumber = lineNumber;
+	Info.EditorControl(ECTL_GETSTRING, &getStringInfo);
+	return getStringInfo;
+}
+
+wstring FarEditorHost::GetFileName()
+{
+	int length = Info.EditorControl(ECTL_GETFILENAME, 0);
+	if (length <= 0)
+		return wstring();
+
+	vector<wchar_t> fileName(length + 1);
+	Info.EditorControl(ECTL_GETFILENAME, &fileName[0]);
+	return wstring(&fileName[0]);
+}
+
+void FarEditorHost::SetPosition(const EditorSetPosition &position)
+{
+	Info.EditorControl(ECTL_SETPOSITION, (void *)&position);
+}
+
+void FarEditorHost::InsertText(const wchar_t *text)
+{
+	Info.EditorControl(ECTL_INSERTTEXT, (void *)text);
+}
+
+void FarEditorHost::DeleteChar()
+{
+	Info.EditorControl(ECTL_DELETECHAR, 0);
+}
+
+void FarEditorHost::UndoRedo(int command)
+{
+	EditorUndoRedo undoRedo;
+	memset(&undoRedo, 0, sizeof(undoRedo));
+	undoRedo.Command = command;
+	Info.EditorControl(ECTL_UNDOREDO, &undoRedo);
+}
+
+void FarEditorHost::Redraw()
+{
+	Info.EditorControl(ECTL_REDRAW, 0);
+}
+
+void FarEditorHost::AddColor(const EditorColor &color)
+{
+	Info.EditorControl(ECTL_ADDCOLOR, (void *)&color);
+}
+
+int FarEditorHost::Menu(MenuItems &items, int x, int y)
+{
+	wchar_t typed;
+	return ShowMenu(items, x, y, false, typed);
+}
+
+int FarEditorHost::PopupMenu(MenuItems &items, int x, int y, wchar_t &typed)
+{
+	return ShowMenu(items, x, y, true, typed);
+}
+
+//a list box in a dialog of its own, only the first page of the words is
+//looked for before it is shown
+int FarEditorHost::ShowMenu(MenuItems &items, int x, int y, bool typing, wchar_t &typed)
+{
+	typed = 0;
+	int count = items.Fetch(MaxMenuSize);
+	if (count == 0)
+		return -1;
+
+	int rows = std::min(count, MaxMenuSize);
+	int longest = 0;
+	vector<FarListItem> page(rows);
+	for (int i = 0; i < rows; i++)
 	{
-		getStringInfo.StringNumber = lineNumber;
-		Info.EditorControl(ECTL_GETSTRING, &getStringInfo);
-		vector<wstring> wordsOfLine = Split(wstring(getStringInfo.StringText));
-		for (vector<wstring>::const_iterator i = wordsOfLine.begin(); i != wordsOfLine.end(); ++i)
+		memset(&page[i], 0, sizeof(page[i]));
+		page[i].Text = items.Item(i).c_str();
+		longest = std::max(longest, (int)items.Item(i).length());
+	}
+	FarList list;
+	list.ItemsNumber = rows;
+	list.Items = &page[0];
+
+	//below the cursor, or above it when there is no room below
+	EditorInfo editorInfo;
+	GetInfo(editorInfo);
+	int width = std::min(longest + 4, editorInfo.WindowSizeX);
+	int height = rows + 2;
+	int left = std::max(std::min(x + 2, editorInfo.WindowSizeX - width), 0);
+	int top = y + 2;
+	if (top + height > editorInfo.WindowSizeY)
+		top = std::max(y + 1 - height, 0);
+
+	FarDialogItem item;
+	memset(&item, 0, sizeof(item));
+	item.Type = DI_LISTBOX;
+	item.X2 = width - 1;
+	item.Y2 = height - 1;
+	item.Focus = TRUE;
+	item.ListItems = &list;
+	item.Flags = DIF_LISTWRAPMODE | DIF_LISTNOAMPERSAND;
+
+	MenuDialog menu;
+	menu.items = &items;
+	menu.itemsShown = rows;
+	menu.typing = typing;
+	menu.typed = 0;
+	HANDLE dialog = Info.DialogInit(Info.ModuleNumber, left, top, left + width - 1, top + height - 1,
+		NULL, &item, 1, 0, FDLG_SMALLDIALOG, MenuDialogProc, (LONG_PTR)&menu);
+	if (dialog == INVALID_HANDLE_VALUE)
+		return -1;
+
+	int choice = -1;
+	if (Info.DialogRun(dialog) == 0)
+		choice = (int)Info.SendDlgMessage(dialog, DM_LISTGETCURPOS, 0, 0);
+	Info.DialogFree(dialog);
+	typed = menu.typed;
+	return choice;
+}
+
+EditorState &GetEditorState(const EditorInfo &editorInfo)
+{
+	map<int, EditorState>::iterator i = Editors.find(editorInfo.EditorID);
+	if (i != Editors.end())
+		return i->second;
+
+	//the editor was opened before the plugin got loaded
+	EditorState &state = Editors[editorInfo.EditorID];
+	SetWordDividers(Host, editorInfo, state, GetWordDividers(Host.GetFileName()));
+	OpenIndex(Host, editorInfo, state);
+	return state;
+}
+
+//the ones set for the file's extension in the plugin's settings, else the
+//editor's, which are FAR's own unless a plugin changed them
+wstring GetWordDividers(const wstring &fileName)
+{
+	size_t dot = fileName.find_last_of(L".\\");
+	if (dot != wstring::npos && fileName[dot] == L'.')
+	{
+		wstring extension = fileName.substr(dot + 1);
+		if (!extension.empty())
+			CharLowerBuffW(&extension[0], (DWORD)extension.length());
+		map<wstring, wstring>::const_iterator i = Options.wordDividers.find(extension);
+		if (i != Options.wordDividers.end())
+			return i->second;
+	}
+
+	wchar_t editorDividers[MaxWordDividers + 1];
+	memset(editorDividers, 0, sizeof(editorDividers));
+	EditorSetParameter parameter;
+	memset(&parameter, 0, sizeof(parameter));
+	parameter.Type = ESPT_GETWORDDIV;
+	parameter.Param.cParam = editorDividers;
+	//newer builds of FAR take the size of the buffer here
+	parameter.Reserved2 = MaxWordDividers + 1;
+	if (Info.EditorControl(ECTL_SETPARAM, &parameter) && editorDividers[0] != 0)
+		return editorDividers;
+
+	int length = (int)Info.AdvControl(Info.ModuleNumber, ACTL_GETSYSWORDDIV, NULL);
+	vector<wchar_t> systemDividers(std::max(length, 0) + 1, 0);
+	Info.AdvControl(Info.ModuleNumber, ACTL_GETSYSWORDDIV, &systemDividers[0]);
+	return &systemDividers[0];
+}
+
+void OnIndexJobDone(IndexJob *job)
+{
+	Info.AdvControl(Info.ModuleNumber, ACTL_SYNCHRO, job);
+}
+
+void OnPopupDue()
+{
+	Info.AdvControl(Info.ModuleNumber, ACTL_SYNCHRO, &PopupSynchro);
+}
+
+void ShowPopupWords()
+{
+	if (!Options.autoPopup || !IsEditorInFocus())
+		return;
+
+	EditorInfo editorInfo;
+	if (!Info.EditorControl(ECTL_GETINFO, &editorInfo))
+		return;
+	//the popup takes over from the ghost text
+	EditorState &state = GetEditorState(editorInfo);
+	if (!state.ghost.text.empty())
+	{
+		HideGhostText(Host, state);
+		Info.EditorControl(ECTL_GETINFO, &editorInfo);
+	}
+	PopUpWords(Host, editorInfo, state);
+}
+
+void ShowGhostWord()
+{
+	if (!Options.ghostText || !IsEditorInFocus())
+		return;
+
+	EditorInfo editorInfo;
+	if (!Info.EditorControl(ECTL_GETINFO, &editorInfo))
+		return;
+	ShowGhostText(Host, editorInfo, GetEditorState(editorInfo), GhostColor());
+}
+
+//a dialog or a menu may have been opened over the editor meanwhile
+bool IsEditorInFocus()
+{
+	WindowInfo window;
+	memset(&window, 0, sizeof(window));
+	window.Pos = -1;
+	return Info.AdvControl(Info.ModuleNumber, ACTL_GETSHORTWINDOWINFO, &window) && window.Type == WTYPE_EDITOR;
+}
+
+//dark gray on the background of the editor's text
+int GhostColor()
+{
+	int textColor = (int)Info.AdvControl(Info.ModuleNumber, ACTL_GETCOLOR, (void *)COL_EDITORTEXT);
+	int background = textColor & 0xF0;
+	return background | (background == BACKGROUND_INTENSITY ? FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE : FOREGROUND_INTENSITY);
+}
+
+//any key or click takes the ghost text away before the editor gets it, except
+//Tab, which keeps it; typing shows the next one once the editor has the key.
+//True when the key is used up
+bool WatchGhostText(INPUT_RECORD *rec)
+{
+	if (rec->EventType == KEY_EVENT)
+	{
+		WORD key = rec->Event.KeyEvent.wVirtualKeyCode;
+		if (!rec->Event.KeyEvent.bKeyDown || key == VK_SHIFT || key == VK_CONTROL || key == VK_MENU || key == VK_CAPITAL)
+			return false;
+	}
+	else if (rec->EventType != MOUSE_EVENT || rec->Event.MouseEvent.dwButtonState == 0)
+		return false;
+
+	EditorInfo editorInfo;
+	Info.EditorControl(ECTL_GETINFO, &editorInfo);
+	EditorState &state = GetEditorState(editorInfo);
+	if (!state.ghost.text.empty())
+	{
+		if (IsItTab(rec))
 		{
-			wstring word = *i;
-			if (word.length() > wordToMatch.length() 
-				&& word.substr(0, wordToMatch.length()) == wordToMatch)
-			{
-				result.insert(word);
-			}
+			AcceptGhostText(Host, state);
+			return true;
 		}
+		HideGhostText(Host, state);
 	}
-	return vector<wstring>(result.begin(), result.end());
+
+	if (rec->EventType == KEY_EVENT && IsItTyping(rec, state.delimiters))
+		Info.AdvControl(Info.ModuleNumber, ACTL_SYNCHRO, &GhostSynchro);
+	return false;
+}
+
+//the editor is left or closed, the ghost text mustn't stay in it; the editor
+//API works on the current editor, so nothing is done when it is another
+void HideEditorGhostText(int editorId)
+{
+	map<int, EditorState>::iterator i = Editors.find(editorId);
+	if (i == Editors.end() || i->second.ghost.text.empty())
+		return;
+
+	EditorInfo editorInfo;
+	if (Info.EditorControl(ECTL_GETINFO, &editorInfo) && editorInfo.EditorID == editorId)
+		HideGhostText(Host, i->second);
+	else
+		i->second.ghost.text.clear();
+}
+
+//every keystroke that goes on with a word delays the popup, anything else cancels it
+void WatchTyping(INPUT_RECORD *rec)
+{
+	if (rec->EventType == MOUSE_EVENT && rec->Event.MouseEvent.dwButtonState != 0)
+	{
+		CancelPopupTimer();
+		return;
+	}
+	if (rec->EventType != KEY_EVENT || !rec->Event.KeyEvent.bKeyDown)
+		return;
+
+	WORD key = rec->Event.KeyEvent.wVirtualKeyCode;
+	if (key == VK_SHIFT || key == VK_CONTROL || key == VK_MENU || key == VK_CAPITAL)
+		return;
+
+	EditorInfo editorInfo;
+	Info.EditorControl(ECTL_GETINFO, &editorInfo);
+	if (IsItTyping(rec, GetEditorState(editorInfo).delimiters))
+		RestartPopupTimer(Options.autoPopupDelay);
+	else
+		CancelPopupTimer();
+}
+
+LONG_PTR WINAPI MenuDialogProc(HANDLE dialog, int message, int param1, LONG_PTR param2)
+{
+	MenuDialog *menu = (MenuDialog *)Info.SendDlgMessage(dialog, DM_GETDLGDATA, 0, 0);
+	if (message == DN_LISTCHANGE && param2 >= menu->itemsShown - 1)
+	{
+		AddMenuPage(dialog, *menu);
+	}
+	else if (message == DN_KEY && menu->typing)
+	{
+		wchar_t typed = TypedChar((int)param2);
+		if (typed != 0)
+		{
+			menu->typed = typed;
+			Info.SendDlgMessage(dialog, DM_CLOSE, -1, 0);
+			return TRUE;
+		}
+	}
+	return Info.DefDlgProc(dialog, message, param1, param2);
+}
+
+//the words past the shown ones are only looked for when they are scrolled to
+void AddMenuPage(HANDLE dialog, MenuDialog &menu)
+{
+	int count = menu.items->Fetch(menu.itemsShown + MaxMenuSize);
+	if (count <= menu.itemsShown)
+		return;
+
+	vector<FarListItem> page(count - menu.itemsShown);
+	for (size_t i = 0; i < page.size(); i++)
+	{
+		memset(&page[i], 0, sizeof(page[i]));
+		page[i].Text = menu.items->Item(menu.itemsShown + (int)i).c_str();
+	}
+	FarList list;
+	list.ItemsNumber = (int)page.size();
+	list.Items = &page[0];
+	//FAR copies the texts
+	Info.SendDlgMessage(dialog, DM_LISTADD, 0, (LONG_PTR)&list);
+	menu.itemsShown = count;
+}
+
+//FAR hands printable keys over as the characters they type, in the current layout
+wchar_t TypedChar(int key)
+{
+	if (key == KEY_BS)
+		return L'\b';
+	if (key >= KEY_SPACE && key < EXTENDED_KEY_BASE)
+		return (wchar_t)key;
+	return 0;
 }
 
 bool IsItHotkey(INPUT_RECORD *rec)
@@ -151,46 +726,37 @@ bool IsItHotkey(INPUT_RECORD *rec)
 	return rec->Event.KeyEvent.wVirtualKeyCode == VK_APPS;
 }
 
-vector<wstring> Split(wstring line)
+bool IsItFuzzyHotkey(INPUT_RECORD *rec)
 {
-	vector<wstring> result;
+	if (rec->EventType != KEY_EVENT || !rec->Event.KeyEvent.bKeyDown)
+		return false;
 
-	wstring::iterator wordStart = find_if(line.begin(), line.end(), IsNotDelimiter);
-	while (wordStart != line.end())
-	{
-		wstring::iterator wordEnd = find_if(wordStart, line.end(), IsDelimiter);
-		if (wordEnd != wordStart)
-		{
-			result.push_back(wstring(wordStart, wordEnd));
-			wordStart = find_if(wordEnd, line.end(), IsNotDelimiter);
-		}
-	}
+	//Ctrl-Shift-Space
+	DWORD state = rec->Event.KeyEvent.dwControlKeyState;
+	bool controlIsPressed = (state & LEFT_CTRL_PRESSED) || (state & RIGHT_CTRL_PRESSED);
+	bool shiftIsPressed = (state & SHIFT_PRESSED) != 0;
 
-	return result;
+	return controlIsPressed && shiftIsPressed && rec->Event.KeyEvent.wVirtualKeyCode == VK_SPACE;
 }
 
-wstring GetCurrentWord(int position)
+bool IsItTab(INPUT_RECORD *rec)
 {
-	EditorGetString getStringInfo;
-	getStringInfo.StringNumber = -1; 
-	Info.EditorControl(ECTL_GETSTRING, &getStringInfo);
-	wstring line(getStringInfo.StringText, position);
-
-	std::reverse(line.begin(), line.end());
-	wstring::const_iterator end = find_if(line.begin(), line.end(), IsDelimiter);
-	wstring word(line.begin(), end);
-	std::reverse(word.begin(), word.end());
+	if (rec->EventType != KEY_EVENT || rec->Event.KeyEvent.wVirtualKeyCode != VK_TAB)
+		return false;
 
-	return word;
+	DWORD state = rec->Event.KeyEvent.dwControlKeyState;
+	return (state & (LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED | LEFT_ALT_PRESSED | RIGHT_ALT_PRESSED | SHIFT_PRESSED)) == 0;
 }
 
-bool IsDelimiter(wchar_t ch)
+bool IsItTyping(INPUT_RECORD *rec, const Delimiters &delimiters)
 {
-	std::locale defaultLocale;
-	return std::isspace(ch, defaultLocale) || (ch != L'_' && std::ispunct(ch, defaultLocale));
-}
+	wchar_t ch = rec->Event.KeyEvent.uChar.UnicodeChar;
+	if (ch == 0 || IsDelimiter(ch, delimiters))
+		return false;
 
-bool IsNotDelimiter(wchar_t ch)
-{
-	return !IsDelimiter(ch);
-}
\ No newline at end of file
+	//AltGr comes as Ctrl-Alt
+	DWORD state = rec->Event.KeyEvent.dwControlKeyState;
+	bool controlIsPressed = (state & LEFT_CTRL_PRESSED) || (state & RIGHT_CTRL_PRESSED);
+	bool altIsPressed = (state & LEFT_ALT_PRESSED) || (state & RIGHT_ALT_PRESSED);
+	return controlIsPressed == altIsPressed;
+}